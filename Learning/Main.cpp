@@ -1,13 +1,23 @@
 #include <iostream>
 #include <format>
+#include <string>
 
 #include "gmath/vec.h"
 #include "gmath/matrix.h"
 #include "gmath/color.h"
 #include "gmath/gmath.h"
+#include "benchmark/benchmark.h"
 
-int main()
+int main(int argc, char* argv[])
 {
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		benchmark::serialize();
+		benchmark::raster();
+		benchmark::particles();
+		return 0;
+	}
+
 	{
 		gmath::mat4_precise a{};
 		gmath::mat4_precise b{};
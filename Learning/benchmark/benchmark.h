@@ -0,0 +1,35 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <string>
+
+namespace benchmark
+{
+	// Runs fn a few times and returns the fastest run in milliseconds
+	template<typename F>
+	double measure(F&& fn, int runs = 5)
+	{
+		double best{ std::numeric_limits<double>::max() };
+		for (int i = 0; i < runs; i++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			fn();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+
+	inline void report(const std::string& name, double ms, double items, const std::string& unit)
+	{
+		std::cout << std::format("{:<40} {:>10.2f} ms {:>14.0f} {}/s", name, ms, items / (ms / 1000.0), unit) << std::endl;
+	}
+
+	void serialize();
+	void raster();
+	void particles();
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include <vector>
+
+#include "benchmark.h"
+#include "../gmath/particles.h"
+
+namespace benchmark
+{
+	namespace
+	{
+		// Fills the system with particles inside the unit box, lifetime seconds each
+		void populate(gmath::particle_system& system, size_t count, float lifetime)
+		{
+			system.clear();
+			system.reserve(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				gmath::vec3 position, velocity;
+				position.randomize(-1.0f, 1.0f);
+				velocity.randomize(-2.0f, 2.0f);
+				system.emit(position, velocity, lifetime);
+			}
+		}
+	}
+
+	void particles()
+	{
+		const size_t count = 1000000;
+		const float dt = 1.0f / 60.0f;
+
+		// The array of structs update this module replaces, one pass over memory per vector operator
+		{
+			std::vector<gmath::vec3> positions(count), velocities(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				positions[i].randomize(-1.0f, 1.0f);
+				velocities[i].randomize(-2.0f, 2.0f);
+			}
+			gmath::vec3 gravity{ 0.0f, -9.81f, 0.0f };
+
+			double ms = measure([&]
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					velocities[i] += gravity * dt;
+					velocities[i] *= 0.99f;
+					positions[i] += velocities[i] * dt;
+				}
+			});
+			report("aos vec3 update 1M particles", ms, static_cast<double>(count), "particles");
+		}
+
+		struct scene
+		{
+			const char* name;
+			gmath::particle_integrator integrator;
+			bool bounded;
+		};
+		const scene scenes[] = {
+			{ "euler update 1M particles", gmath::particle_integrator::semi_implicit_euler, false },
+			{ "euler update 1M bounded particles", gmath::particle_integrator::semi_implicit_euler, true },
+			{ "verlet update 1M bounded particles", gmath::particle_integrator::verlet, true },
+		};
+
+		for (const scene& s : scenes)
+		{
+			gmath::particle_config config;
+			config.integrator = s.integrator;
+			config.drag = 0.5f;
+			config.bounded = s.bounded;
+			gmath::particle_system system(config);
+			populate(system, count, 1000.0f);
+
+			double ms = measure([&] { system.update(dt); });
+			report(s.name, ms, static_cast<double>(count), "particles");
+		}
+
+		// Every particle expires within 64 steps, so each step swap-removes about 1.5% of them
+		{
+			gmath::particle_system system;
+			system.reserve(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				gmath::vec3 position, velocity;
+				position.randomize(-1.0f, 1.0f);
+				velocity.randomize(-2.0f, 2.0f);
+				system.emit(position, velocity, gmath::random(0.0f, 64.0f * dt));
+			}
+
+			size_t updated = 0;
+			double ms = measure([&] { updated = system.size(); system.update(dt); });
+			report("euler update with expiring particles", ms, static_cast<double>(updated), "particles");
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include <vector>
+
+#include "benchmark.h"
+#include "../gmath/projection.h"
+#include "../gmath/raster.h"
+
+namespace benchmark
+{
+	namespace
+	{
+		struct mesh
+		{
+			std::vector<gmath::vec3> positions;
+			std::vector<gmath::color> colors;
+			std::vector<uint32_t> indices;
+		};
+
+		// Independent triangles of about the given edge length scattered through the view volume
+		mesh scatter(size_t triangles, float size)
+		{
+			mesh m;
+			m.positions.reserve(triangles * 3);
+			for (size_t i = 0; i < triangles; i++)
+			{
+				gmath::vec3 center;
+				center.randomize(-4.0f, 4.0f);
+				center.z -= 10.0f;
+				for (size_t k = 0; k < 3; k++)
+				{
+					gmath::vec3 offset;
+					offset.randomize(-size, size);
+					m.positions.push_back(gmath::vec3{ center.x + offset.x, center.y + offset.y, center.z + offset.z });
+					gmath::color c;
+					c.randomize(0, 255);
+					c.a = 255;
+					m.colors.push_back(c);
+					m.indices.push_back(static_cast<uint32_t>(i * 3 + k));
+				}
+			}
+			return m;
+		}
+	}
+
+	void raster()
+	{
+		const size_t width = 1920;
+		const size_t height = 1080;
+
+		gmath::image<gmath::color> target(width, height);
+		gmath::image<float> depth(width, height);
+		gmath::rasterizer<uint8_t> rasterizer;
+		gmath::mat4 mvp = gmath::mat4::perspective(60.0f, static_cast<float>(width) / height, 0.1f, 100.0f);
+		gmath::viewport vp{ 0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height) };
+
+		struct scene
+		{
+			const char* name;
+			size_t triangles;
+			float size;
+		};
+		const scene scenes[] = {
+			{ "rasterize 1M small triangles", 1000000, 0.02f },
+			{ "rasterize 100k medium triangles", 100000, 0.2f },
+			{ "rasterize 10k large triangles", 10000, 1.5f },
+		};
+
+		for (const scene& s : scenes)
+		{
+			mesh m = scatter(s.triangles, s.size);
+			std::vector<gmath::vec4> screen(m.positions.size());
+
+			double ms = measure([&] { gmath::project(mvp, vp, m.positions.data(), screen.data(), nullptr, m.positions.size()); });
+			report("project vertices", ms, static_cast<double>(m.positions.size()), "vertices");
+
+			ms = measure([&]
+			{
+				gmath::rasterizer<uint8_t>::clear(target.view(), gmath::color(0, 0, 0, 255), depth.view());
+				rasterizer.draw(target.view(), depth.view(), screen, m.colors, m.indices);
+			});
+			report(s.name, ms, static_cast<double>(s.triangles), "triangles");
+		}
+	}
+}
\ No newline at end of file
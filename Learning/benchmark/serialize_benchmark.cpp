@@ -0,0 +1,75 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "../gmath/serialize.h"
+
+namespace benchmark
+{
+	void serialize()
+	{
+		const size_t count = 1000000;
+
+		std::vector<gmath::vec3> points(count);
+		std::vector<gmath::mat4> matrices(count / 10);
+		std::vector<gmath::color> colors(count);
+		for (gmath::vec3& p : points)
+			p.randomize(-1000.0f, 1000.0f);
+		for (gmath::mat4& m : matrices)
+			m.randomize();
+		for (gmath::color& c : colors)
+			c.randomize(0, 255);
+
+		std::vector<char> buffer(count * gmath::max_chars<gmath::vec3>());
+		char* first = buffer.data();
+		char* last = buffer.data() + buffer.size();
+		char* end{};
+
+		double ms = measure([&]
+		{
+			std::string text;
+			for (const gmath::vec3& p : points)
+				text += p.to_string();
+		});
+		report("vec3 to_string", ms, count, "vec3");
+
+		ms = measure([&] { end = gmath::to_chars(first, last, points.data(), points.size()).ptr; });
+		report("vec3 to_chars", ms, count, "vec3");
+
+		std::vector<gmath::vec3> parsed(count);
+		size_t parsed_count{};
+		ms = measure([&] { gmath::from_chars(first, end, parsed.data(), parsed.size(), parsed_count); });
+		report("vec3 from_chars", ms, parsed_count, "vec3");
+
+		ms = measure([&]
+		{
+			std::stringstream ss(std::string(first, end));
+			for (gmath::vec3& p : parsed)
+				ss >> p.x >> p.y >> p.z;
+		});
+		report("vec3 stringstream >>", ms, count, "vec3");
+
+		ms = measure([&]
+		{
+			std::stringstream ss;
+			for (const gmath::mat4& m : matrices)
+				ss << m << "\n";
+		});
+		report("mat4 operator<<", ms, matrices.size(), "mat4");
+
+		ms = measure([&] { end = gmath::to_chars(first, last, matrices.data(), matrices.size()).ptr; });
+		report("mat4 to_chars", ms, matrices.size(), "mat4");
+
+		ms = measure([&]
+		{
+			std::string text;
+			for (const gmath::color& c : colors)
+				text += c.to_string();
+		});
+		report("color to_string", ms, count, "color");
+
+		ms = measure([&] { end = gmath::to_chars(first, last, colors.data(), colors.size()).ptr; });
+		report("color to_chars", ms, count, "color");
+	}
+}
\ No newline at end of file
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "gmath.h"
+#include "vec.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace gmath
+{
+	/*
+	* Keyframe tracks in SoA order: the key times of every track are concatenated into one array and so is every component
+	* of the key values, a track is a range of them. Sampling first finds the key pair of each track through a cursor that
+	* remembers the last pair, so playing forward costs a comparison or two per track. The interpolation then runs on
+	* a register of tracks at once.
+	*/
+
+	enum class track_interpolation
+	{
+		linear,
+		// Linear over unit quaternions (x, y, z, w) on the shorter arc, renormalized
+		nlerp
+	};
+
+	// Last key pair per track, one per playback position, so several instances can play the same tracks
+	struct track_cursor
+	{
+		std::vector<uint32_t> keys;
+	};
+
+	// Joint pose, rotation is a unit quaternion (x, y, z, w) like the quat encodings of encoding.h
+	struct trs
+	{
+		vec3 translation{ 0.0f, 0.0f, 0.0f };
+		vec4 rotation{ 0.0f, 0.0f, 0.0f, 1.0f };
+		vec3 scale{ 1.0f, 1.0f, 1.0f };
+	};
+
+	template<size_t N>
+	class keyframe_tracks
+	{
+	public:
+		static constexpr size_t lanes = simd_native_width<float>();
+		using lane_type = simd<float, lanes>;
+
+		explicit keyframe_tracks(track_interpolation interpolation = track_interpolation::linear)
+			: interpolation(interpolation) {}
+
+		// Appends a track and returns its index, times must be ascending
+		size_t add(const float* times, const vector<float, N>* values, size_t count)
+		{
+			if (count == 0)
+				throw std::runtime_error("gmath: a keyframe track needs at least one key");
+
+			offsets.push_back(static_cast<uint32_t>(key_times.size()));
+			counts.push_back(static_cast<uint32_t>(count));
+			key_times.insert(key_times.end(), times, times + count);
+			for (size_t d = 0; d < N; d++)
+			{
+				for (size_t k = 0; k < count; k++)
+					key_values[d].push_back(values[k][d]);
+			}
+			end_time = std::max(end_time, times[count - 1]);
+			return offsets.size() - 1;
+		}
+
+		size_t size() const
+		{
+			return offsets.size();
+		}
+
+		// Time of the last key over all tracks
+		float duration() const
+		{
+			return end_time;
+		}
+
+		// Tracks clamp to their first and last key outside their own time range
+		void sample(float time, track_cursor& cursor, vector<float, N>* out) const
+		{
+			prepare(cursor);
+			parallel_batch(size(), [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i += lanes)
+				{
+					size_t n = std::min(lanes, last - i);
+					lane_type result[N];
+					sample_lanes(time, cursor, i, n, result);
+					float values[N][lanes];
+					for (size_t d = 0; d < N; d++)
+						result[d].store(values[d]);
+					for (size_t l = 0; l < n; l++)
+					{
+						for (size_t d = 0; d < N; d++)
+							out[i + l][d] = values[d][l];
+					}
+				}
+			});
+		}
+
+		void prepare(track_cursor& cursor) const
+		{
+			if (cursor.keys.size() != size())
+				cursor.keys.assign(size(), 0);
+		}
+
+		// Interpolates tracks [first, first + n) into one register per component, n <= lanes and the cursor must be prepared
+		void sample_lanes(float time, track_cursor& cursor, size_t first, size_t n, lane_type* out) const
+		{
+			float a[N][lanes]{}, b[N][lanes]{}, alpha[lanes]{};
+			for (size_t l = 0; l < n; l++)
+			{
+				size_t track = first + l;
+				const float* times = key_times.data() + offsets[track];
+				uint32_t count = counts[track];
+				uint32_t k = find_key(times, count, cursor.keys[track], time);
+				cursor.keys[track] = k;
+
+				uint32_t next = std::min(k + 1, count - 1);
+				float span = times[next] - times[k];
+				alpha[l] = span > 0.0f ? std::clamp((time - times[k]) / span, 0.0f, 1.0f) : 0.0f;
+				for (size_t d = 0; d < N; d++)
+				{
+					a[d][l] = key_values[d][offsets[track] + k];
+					b[d][l] = key_values[d][offsets[track] + next];
+				}
+			}
+
+			lane_type t = lane_type::load(alpha);
+			lane_type va[N], vb[N];
+			for (size_t d = 0; d < N; d++)
+			{
+				va[d] = lane_type::load(a[d]);
+				vb[d] = lane_type::load(b[d]);
+			}
+
+			if (interpolation == track_interpolation::nlerp)
+			{
+				// q and -q are the same rotation, flipping b takes the shorter way round
+				lane_type dot(0.0f);
+				for (size_t d = 0; d < N; d++)
+					dot = fma(va[d], vb[d], dot);
+				auto flip = dot < lane_type(0.0f);
+				for (size_t d = 0; d < N; d++)
+					vb[d] = select(flip, -vb[d], vb[d]);
+			}
+
+			lane_type length(0.0f);
+			for (size_t d = 0; d < N; d++)
+			{
+				out[d] = fma(vb[d] - va[d], t, va[d]);
+				length = fma(out[d], out[d], length);
+			}
+
+			if (interpolation == track_interpolation::nlerp)
+			{
+				// Padding lanes are all zero, the select keeps them from turning into NaN
+				lane_type scale = select(length > lane_type(0.0f), lane_type(1.0f) / sqrt(length), lane_type(0.0f));
+				for (size_t d = 0; d < N; d++)
+					out[d] *= scale;
+			}
+		}
+
+	private:
+		track_interpolation interpolation;
+		std::vector<float> key_times;
+		std::vector<float> key_values[N];
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> counts;
+		float end_time{};
+
+		// Index of the last key at or before time, starting from the cached one. Playing forward usually moves it by zero
+		// or one key, larger jumps and seeking backwards fall back to a binary search.
+		static uint32_t find_key(const float* times, uint32_t count, uint32_t cached, float time)
+		{
+			uint32_t k = cached < count ? cached : 0;
+			if (time >= times[k])
+			{
+				for (uint32_t step = 0; step < 4; step++)
+				{
+					if (k + 1 >= count || times[k + 1] > time)
+						return k;
+					k++;
+				}
+				if (k + 1 >= count || times[k + 1] > time)
+					return k;
+				return static_cast<uint32_t>(std::upper_bound(times + k, times + count, time) - times) - 1;
+			}
+			uint32_t upper = static_cast<uint32_t>(std::upper_bound(times, times + k, time) - times);
+			return upper == 0 ? 0 : upper - 1;
+		}
+	};
+
+	/*
+	* Translation, rotation and scale tracks of a skeleton, track i of every set belongs to joint i.
+	* Sampling writes poses or goes straight to a matrix palette, the matrices are built in the same registers
+	* as the interpolation so no pose is stored in between.
+	*/
+	class skeletal_animation
+	{
+	public:
+		keyframe_tracks<3> translations{ track_interpolation::linear };
+		keyframe_tracks<4> rotations{ track_interpolation::nlerp };
+		keyframe_tracks<3> scales{ track_interpolation::linear };
+
+		struct cursor
+		{
+			track_cursor translations;
+			track_cursor rotations;
+			track_cursor scales;
+		};
+
+		size_t joints() const
+		{
+			return translations.size();
+		}
+
+		float duration() const
+		{
+			return std::max({ translations.duration(), rotations.duration(), scales.duration() });
+		}
+
+		void sample(float time, cursor& c, trs* out) const
+		{
+			for_each_block(time, c, [out](size_t first, size_t n, const lane_type* t, const lane_type* r, const lane_type* s)
+			{
+				float lanes_t[3][lanes], lanes_r[4][lanes], lanes_s[3][lanes];
+				for (size_t d = 0; d < 3; d++)
+				{
+					t[d].store(lanes_t[d]);
+					s[d].store(lanes_s[d]);
+				}
+				for (size_t d = 0; d < 4; d++)
+					r[d].store(lanes_r[d]);
+				for (size_t l = 0; l < n; l++)
+				{
+					trs& pose = out[first + l];
+					for (size_t d = 0; d < 3; d++)
+					{
+						pose.translation[d] = lanes_t[d][l];
+						pose.scale[d] = lanes_s[d][l];
+					}
+					for (size_t d = 0; d < 4; d++)
+						pose.rotation[d] = lanes_r[d][l];
+				}
+			});
+		}
+
+		// Local joint matrices for row vectors, scale then rotation then translation like scale(s) * rotation * translation(t)
+		void sample(float time, cursor& c, mat4* palette) const
+		{
+			for_each_block(time, c, [palette](size_t first, size_t n, const lane_type* t, const lane_type* r, const lane_type* s)
+			{
+				lane_type m[16];
+				compose(t, r, s, m);
+				float values[16][lanes];
+				for (size_t e = 0; e < 16; e++)
+					m[e].store(values[e]);
+				for (size_t l = 0; l < n; l++)
+				{
+					for (size_t e = 0; e < 16; e++)
+						palette[first + l].elements[e] = values[e][l];
+				}
+			});
+		}
+
+	private:
+		static constexpr size_t lanes = simd_native_width<float>();
+		using lane_type = simd<float, lanes>;
+
+		template<typename F>
+		void for_each_block(float time, cursor& c, F emit) const
+		{
+			if (rotations.size() != joints() || scales.size() != joints())
+				throw std::runtime_error("gmath: translation, rotation and scale track counts differ");
+
+			translations.prepare(c.translations);
+			rotations.prepare(c.rotations);
+			scales.prepare(c.scales);
+			parallel_batch(joints(), [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i += lanes)
+				{
+					size_t n = std::min(lanes, last - i);
+					lane_type t[3], r[4], s[3];
+					translations.sample_lanes(time, c.translations, i, n, t);
+					rotations.sample_lanes(time, c.rotations, i, n, r);
+					scales.sample_lanes(time, c.scales, i, n, s);
+					emit(i, n, t, r, s);
+				}
+			});
+		}
+
+		// Row i of the rotation is the image of axis i, scaled by s[i], the translation fills the last row
+		static void compose(const lane_type* t, const lane_type* q, const lane_type* s, lane_type* m)
+		{
+			lane_type one(1.0f), two(2.0f), zero(0.0f);
+			lane_type xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+			lane_type xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+			lane_type wx = q[3] * q[0], wy = q[3] * q[1], wz = q[3] * q[2];
+
+			m[0] = (one - two * (yy + zz)) * s[0];
+			m[1] = two * (xy + wz) * s[0];
+			m[2] = two * (xz - wy) * s[0];
+			m[3] = zero;
+			m[4] = two * (xy - wz) * s[1];
+			m[5] = (one - two * (xx + zz)) * s[1];
+			m[6] = two * (yz + wx) * s[1];
+			m[7] = zero;
+			m[8] = two * (xz + wy) * s[2];
+			m[9] = two * (yz - wx) * s[2];
+			m[10] = (one - two * (xx + yy)) * s[2];
+			m[11] = zero;
+			m[12] = t[0];
+			m[13] = t[1];
+			m[14] = t[2];
+			m[15] = one;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <vector>
+#include <utility>
+
+namespace gmath
+{
+	/*
+	* Bump allocator for temporary batches of vectors, matrices and colors.
+	* Memory is handed out from large blocks and released all at once with reset(), which keeps the blocks around,
+	* so after the first frame a steady workload never reaches the heap again.
+	*/
+	class arena
+	{
+	public:
+		static constexpr size_t default_alignment = 16;
+
+		explicit arena(size_t capacity = 1 << 20)
+			: first_capacity(std::max(capacity, max_alignment)) {}
+
+		arena(const arena&) = delete;
+		arena& operator=(const arena&) = delete;
+
+		arena(arena&& other) noexcept
+			: blocks(std::move(other.blocks)), current(other.current), offset(other.offset), first_capacity(other.first_capacity)
+		{
+			other.current = 0;
+			other.offset = 0;
+		}
+
+		arena& operator=(arena&& other) noexcept
+		{
+			if (this != &other)
+			{
+				release();
+				blocks = std::move(other.blocks);
+				current = other.current;
+				offset = other.offset;
+				first_capacity = other.first_capacity;
+				other.current = 0;
+				other.offset = 0;
+			}
+			return *this;
+		}
+
+		~arena()
+		{
+			release();
+		}
+
+		void* allocate(size_t bytes, size_t alignment = default_alignment)
+		{
+			for (;;)
+			{
+				if (current < blocks.size())
+				{
+					block& b = blocks[current];
+					uintptr_t base = reinterpret_cast<uintptr_t>(b.data);
+					size_t aligned = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+					if (aligned + bytes <= b.capacity)
+					{
+						offset = aligned + bytes;
+						return b.data + aligned;
+					}
+					if (current + 1 < blocks.size())
+					{
+						current++;
+						offset = 0;
+						continue;
+					}
+				}
+				grow(bytes + alignment);
+			}
+		}
+
+		template<typename T>
+		T* allocate(size_t count)
+		{
+			constexpr size_t alignment = alignof(T) > default_alignment ? alignof(T) : default_alignment;
+			return static_cast<T*>(allocate(sizeof(T) * count, alignment));
+		}
+
+		// Default constructed elements, meant for the trivially destructible vec, matrix and color types
+		template<typename T>
+		std::span<T> allocate_span(size_t count)
+		{
+			T* data = allocate<T>(count);
+			for (size_t i = 0; i < count; i++)
+				new (data + i) T{};
+			return { data, count };
+		}
+
+		// Releases every allocation in O(1), the blocks stay allocated for the next frame
+		void reset()
+		{
+			current = 0;
+			offset = 0;
+		}
+
+		/*
+		* Markers allow nested scopes to give back their temporaries without resetting the whole arena.
+		*/
+
+		struct marker
+		{
+			size_t block;
+			size_t offset;
+		};
+
+		marker mark() const
+		{
+			return { current, offset };
+		}
+
+		void rewind(const marker& m)
+		{
+			current = m.block;
+			offset = m.offset;
+		}
+
+		size_t used() const
+		{
+			size_t total{ offset };
+			for (size_t i = 0; i < current && i < blocks.size(); i++)
+				total += blocks[i].capacity;
+			return total;
+		}
+
+		size_t capacity() const
+		{
+			size_t total{};
+			for (const block& b : blocks)
+				total += b.capacity;
+			return total;
+		}
+
+	private:
+		static constexpr size_t max_alignment = 64;
+
+		struct block
+		{
+			std::byte* data;
+			size_t capacity;
+		};
+
+		// Grows geometrically so the number of blocks stays logarithmic in the peak usage
+		void grow(size_t minimum)
+		{
+			size_t capacity = blocks.empty() ? first_capacity : blocks.back().capacity * 2;
+			while (capacity < minimum)
+				capacity *= 2;
+			blocks.push_back({ static_cast<std::byte*>(::operator new(capacity, std::align_val_t{ max_alignment })), capacity });
+			current = blocks.size() - 1;
+			offset = 0;
+		}
+
+		void release()
+		{
+			for (block& b : blocks)
+				::operator delete(b.data, std::align_val_t{ max_alignment });
+			blocks.clear();
+		}
+
+		std::vector<block> blocks;
+		size_t current{};
+		size_t offset{};
+		size_t first_capacity;
+	};
+
+	// Rewinds the arena to where it was on construction
+	class arena_scope
+	{
+	public:
+		explicit arena_scope(arena& a)
+			: a(a), m(a.mark()) {}
+
+		arena_scope(const arena_scope&) = delete;
+		arena_scope& operator=(const arena_scope&) = delete;
+
+		~arena_scope()
+		{
+			a.rewind(m);
+		}
+
+	private:
+		arena& a;
+		arena::marker m;
+	};
+
+	// Arena owned by the calling thread, reset it once per frame
+	inline arena& frame_arena()
+	{
+		thread_local arena a{};
+		return a;
+	}
+
+	/*
+	* Standard allocator on top of an arena, deallocation is a no-op and memory returns on reset.
+	* Defaults to the frame arena of the calling thread.
+	*/
+	template<typename T>
+	class arena_allocator
+	{
+	public:
+		using value_type = T;
+
+		arena_allocator()
+			: source(&frame_arena()) {}
+
+		arena_allocator(arena& a)
+			: source(&a) {}
+
+		template<typename U>
+		arena_allocator(const arena_allocator<U>& other)
+			: source(other.source) {}
+
+		T* allocate(size_t count)
+		{
+			return source->allocate<T>(count);
+		}
+
+		void deallocate(T*, size_t) {}
+
+		template<typename U>
+		bool operator==(const arena_allocator<U>& other) const
+		{
+			return source == other.source;
+		}
+
+		template<typename U>
+		bool operator!=(const arena_allocator<U>& other) const
+		{
+			return source != other.source;
+		}
+
+	private:
+		template<typename U>
+		friend class arena_allocator;
+
+		arena* source;
+	};
+
+	template<typename T>
+	using arena_vector = std::vector<T, arena_allocator<T>>;
+
+	// Alloc for elements of type U, the temporaries of functions taking an allocator come from the same source
+	template<typename Alloc, typename U>
+	using rebind_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+
+/*
+* AVX kernels for 4-wide doubles, used by vec4_precise and mat4_precise when the compiler targets AVX.
+* The x64 configurations of the project build with /arch:AVX, other builds need -mavx or an equivalent flag.
+* They work on plain double arrays so vec.h and matrix.h can call them from their generic code.
+* Element-wise arithmetic, the matrix product, transpose and transform do every multiply and add in the same order
+* as the scalar loops, so they match them bit for bit as long as the compiler does not contract the scalar loops to FMA.
+* The project sets /fp:precise, which MSVC never contracts under, and /arch:AVX has no FMA instructions anyway.
+* GCC and Clang contract by default once FMA is enabled, builds with -mfma or -march=native need -ffp-contract=off.
+* dot sums the products pairwise and the inverse uses 2x2 sub-determinants, both differ from the scalar path
+* by a few ulp at most.
+*/
+
+#if defined(__AVX__)
+#define GMATH_AVX
+#include <immintrin.h>
+
+namespace gmath
+{
+	namespace detail
+	{
+		inline void add4d(const double* a, const double* b, double* out)
+		{
+			_mm256_storeu_pd(out, _mm256_add_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+		}
+
+		inline void sub4d(const double* a, const double* b, double* out)
+		{
+			_mm256_storeu_pd(out, _mm256_sub_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+		}
+
+		inline void mul4d(const double* a, const double* b, double* out)
+		{
+			_mm256_storeu_pd(out, _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+		}
+
+		inline void div4d(const double* a, const double* b, double* out)
+		{
+			_mm256_storeu_pd(out, _mm256_div_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+		}
+
+		inline void add4d(const double* a, const double b, double* out)
+		{
+			_mm256_storeu_pd(out, _mm256_add_pd(_mm256_loadu_pd(a), _mm256_set1_pd(b)));
+		}
+
+		inline void sub4d(const double* a, const double b, double* out)
+		{
+			_mm256_storeu_pd(out, _mm256_sub_pd(_mm256_loadu_pd(a), _mm256_set1_pd(b)));
+		}
+
+		inline void mul4d(const double* a, const double b, double* out)
+		{
+			_mm256_storeu_pd(out, _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_set1_pd(b)));
+		}
+
+		inline void div4d(const double* a, const double b, double* out)
+		{
+			_mm256_storeu_pd(out, _mm256_div_pd(_mm256_loadu_pd(a), _mm256_set1_pd(b)));
+		}
+
+		inline double hsum4d(const __m256d& v)
+		{
+			__m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+			return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+		}
+
+		inline double dot4d(const double* a, const double* b)
+		{
+			return hsum4d(_mm256_mul_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b)));
+		}
+
+		// Row i of the product is the sum of b's rows weighted by row i of a, accumulated from zero like the scalar loop
+		inline void multiply4x4d(const double* a, const double* b, double* out)
+		{
+			__m256d b0 = _mm256_loadu_pd(b);
+			__m256d b1 = _mm256_loadu_pd(b + 4);
+			__m256d b2 = _mm256_loadu_pd(b + 8);
+			__m256d b3 = _mm256_loadu_pd(b + 12);
+			for (size_t i = 0; i < 4; i++)
+			{
+				const double* row = a + i * 4;
+				__m256d sum = _mm256_add_pd(_mm256_setzero_pd(), _mm256_mul_pd(_mm256_broadcast_sd(row), b0));
+				sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_broadcast_sd(row + 1), b1));
+				sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_broadcast_sd(row + 2), b2));
+				sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_broadcast_sd(row + 3), b3));
+				_mm256_storeu_pd(out + i * 4, sum);
+			}
+		}
+
+		inline void transpose4x4d(const double* m, double* out)
+		{
+			__m256d r0 = _mm256_loadu_pd(m);
+			__m256d r1 = _mm256_loadu_pd(m + 4);
+			__m256d r2 = _mm256_loadu_pd(m + 8);
+			__m256d r3 = _mm256_loadu_pd(m + 12);
+
+			__m256d t0 = _mm256_unpacklo_pd(r0, r1); // m00 m10 m02 m12
+			__m256d t1 = _mm256_unpackhi_pd(r0, r1); // m01 m11 m03 m13
+			__m256d t2 = _mm256_unpacklo_pd(r2, r3); // m20 m30 m22 m32
+			__m256d t3 = _mm256_unpackhi_pd(r2, r3); // m21 m31 m23 m33
+
+			_mm256_storeu_pd(out, _mm256_permute2f128_pd(t0, t2, 0x20));
+			_mm256_storeu_pd(out + 4, _mm256_permute2f128_pd(t1, t3, 0x20));
+			_mm256_storeu_pd(out + 8, _mm256_permute2f128_pd(t0, t2, 0x31));
+			_mm256_storeu_pd(out + 12, _mm256_permute2f128_pd(t1, t3, 0x31));
+		}
+
+		// v * m for a row vector, the same order of operations as summing v[i] * row i from zero
+		inline void transform4d(const double* m, const double* v, double* out)
+		{
+			__m256d sum = _mm256_add_pd(_mm256_setzero_pd(), _mm256_mul_pd(_mm256_broadcast_sd(v), _mm256_loadu_pd(m)));
+			sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_broadcast_sd(v + 1), _mm256_loadu_pd(m + 4)));
+			sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_broadcast_sd(v + 2), _mm256_loadu_pd(m + 8)));
+			sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_broadcast_sd(v + 3), _mm256_loadu_pd(m + 12)));
+			_mm256_storeu_pd(out, sum);
+		}
+
+		/*
+		* Cofactor expansion over 2x2 sub-determinants, computing four cofactors per vector.
+		* The matrix is read as rows m[i][j] = m[i * 4 + j]. Inverting the transpose gives the transposed inverse,
+		* so the same code works for either storage order.
+		*/
+		inline void inverse4x4d(const double* m, double* out)
+		{
+			auto at = [m](size_t i, size_t j) { return m[i * 4 + j]; };
+
+			// 2x2 determinants of columns x and y over the row pairs (2, 3), (2, 3), (1, 3) and (1, 2)
+			auto factor = [&at](size_t x, size_t y)
+			{
+				__m256d a = _mm256_setr_pd(at(2, x), at(2, x), at(1, x), at(1, x));
+				__m256d b = _mm256_setr_pd(at(3, y), at(3, y), at(3, y), at(2, y));
+				__m256d c = _mm256_setr_pd(at(3, x), at(3, x), at(3, x), at(2, x));
+				__m256d d = _mm256_setr_pd(at(2, y), at(2, y), at(1, y), at(1, y));
+				return _mm256_sub_pd(_mm256_mul_pd(a, b), _mm256_mul_pd(c, d));
+			};
+
+			__m256d fac0 = factor(2, 3);
+			__m256d fac1 = factor(1, 3);
+			__m256d fac2 = factor(1, 2);
+			__m256d fac3 = factor(0, 3);
+			__m256d fac4 = factor(0, 2);
+			__m256d fac5 = factor(0, 1);
+
+			__m256d vec0 = _mm256_setr_pd(at(1, 0), at(0, 0), at(0, 0), at(0, 0));
+			__m256d vec1 = _mm256_setr_pd(at(1, 1), at(0, 1), at(0, 1), at(0, 1));
+			__m256d vec2 = _mm256_setr_pd(at(1, 2), at(0, 2), at(0, 2), at(0, 2));
+			__m256d vec3 = _mm256_setr_pd(at(1, 3), at(0, 3), at(0, 3), at(0, 3));
+
+			auto combine = [](__m256d v0, __m256d f0, __m256d v1, __m256d f1, __m256d v2, __m256d f2)
+			{
+				return _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(v0, f0), _mm256_mul_pd(v1, f1)), _mm256_mul_pd(v2, f2));
+			};
+
+			const __m256d sign_a = _mm256_setr_pd(0.0, -0.0, 0.0, -0.0);
+			const __m256d sign_b = _mm256_setr_pd(-0.0, 0.0, -0.0, 0.0);
+			__m256d inv0 = _mm256_xor_pd(combine(vec1, fac0, vec2, fac1, vec3, fac2), sign_a);
+			__m256d inv1 = _mm256_xor_pd(combine(vec0, fac0, vec2, fac3, vec3, fac4), sign_b);
+			__m256d inv2 = _mm256_xor_pd(combine(vec0, fac1, vec1, fac3, vec3, fac5), sign_a);
+			__m256d inv3 = _mm256_xor_pd(combine(vec0, fac2, vec1, fac4, vec2, fac5), sign_b);
+
+			// The first element of every row are the cofactors of row 0
+			__m256d cofactors = _mm256_setr_pd(_mm256_cvtsd_f64(inv0), _mm256_cvtsd_f64(inv1), _mm256_cvtsd_f64(inv2), _mm256_cvtsd_f64(inv3));
+			__m256d inverse_determinant = _mm256_set1_pd(1.0 / hsum4d(_mm256_mul_pd(_mm256_loadu_pd(m), cofactors)));
+
+			_mm256_storeu_pd(out, _mm256_mul_pd(inv0, inverse_determinant));
+			_mm256_storeu_pd(out + 4, _mm256_mul_pd(inv1, inverse_determinant));
+			_mm256_storeu_pd(out + 8, _mm256_mul_pd(inv2, inverse_determinant));
+			_mm256_storeu_pd(out + 12, _mm256_mul_pd(inv3, inverse_determinant));
+		}
+	}
+}
+#endif
\ No newline at end of file
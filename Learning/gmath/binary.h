@@ -0,0 +1,394 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "platform.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "vec.h"
+#include "matrix.h"
+#include "color.h"
+
+namespace gmath
+{
+	/*
+	* Binary container for arrays of vectors, matrices and colors.
+	* A 64 byte little endian header is followed by the tightly packed elements, starting at a 64 byte aligned offset,
+	* so a memory mapped file can be used in place without copying.
+	*/
+
+	enum class binary_kind : uint8_t
+	{
+		vector = 1,
+		matrix = 2,
+		color = 3
+	};
+
+	enum class binary_scalar : uint8_t
+	{
+		i8 = 1, u8, i16, u16, i32, u32, i64, u64, f32, f64
+	};
+
+	struct binary_header
+	{
+		static constexpr uint32_t magic_value = 0x48544D47; // "GMTH"
+		static constexpr uint16_t current_version = 1;
+		static constexpr uint64_t data_alignment = 64;
+
+		uint32_t magic;
+		uint16_t version;
+		binary_kind kind;
+		binary_scalar scalar;
+		uint32_t n;
+		uint32_t m;
+		uint32_t element_size;
+		uint32_t reserved0;
+		uint64_t count;
+		uint64_t data_offset;
+		uint8_t reserved1[24];
+	};
+
+	static_assert(sizeof(binary_header) == 64, "binary_header must stay 64 bytes");
+
+	template<typename T>
+	constexpr binary_scalar binary_scalar_of()
+	{
+		if constexpr (std::is_same_v<T, int8_t>) return binary_scalar::i8;
+		else if constexpr (std::is_same_v<T, uint8_t>) return binary_scalar::u8;
+		else if constexpr (std::is_same_v<T, int16_t>) return binary_scalar::i16;
+		else if constexpr (std::is_same_v<T, uint16_t>) return binary_scalar::u16;
+		else if constexpr (std::is_same_v<T, int32_t>) return binary_scalar::i32;
+		else if constexpr (std::is_same_v<T, uint32_t>) return binary_scalar::u32;
+		else if constexpr (std::is_same_v<T, int64_t>) return binary_scalar::i64;
+		else if constexpr (std::is_same_v<T, uint64_t>) return binary_scalar::u64;
+		else if constexpr (std::is_same_v<T, float>) return binary_scalar::f32;
+		else if constexpr (std::is_same_v<T, double>) return binary_scalar::f64;
+		else static_assert(sizeof(T) == 0, "unsupported scalar type for the binary format");
+	}
+
+	/*
+	* Element layouts that can be stored, the in-memory size has to match the packed size for zero copy access.
+	*/
+
+	template<typename Elem>
+	struct binary_layout;
+
+	template<typename T, size_t N>
+	struct binary_layout<vector<T, N>>
+	{
+		static constexpr binary_kind kind = binary_kind::vector;
+		static constexpr binary_scalar scalar = binary_scalar_of<T>();
+		static constexpr uint32_t n = N;
+		static constexpr uint32_t m = 1;
+		static_assert(sizeof(vector<T, N>) == sizeof(T) * N, "vector is not tightly packed");
+	};
+
+	template<typename T, size_t N, size_t M>
+	struct binary_layout<matrix<T, N, M>>
+	{
+		static constexpr binary_kind kind = binary_kind::matrix;
+		static constexpr binary_scalar scalar = binary_scalar_of<T>();
+		static constexpr uint32_t n = N;
+		static constexpr uint32_t m = M;
+		static_assert(sizeof(matrix<T, N, M>) == sizeof(T) * N * M, "matrix is not tightly packed");
+	};
+
+	template<typename T>
+	struct binary_layout<color_base<T>>
+	{
+		static constexpr binary_kind kind = binary_kind::color;
+		static constexpr binary_scalar scalar = binary_scalar_of<T>();
+		static constexpr uint32_t n = 4;
+		static constexpr uint32_t m = 1;
+		static_assert(sizeof(color_base<T>) == sizeof(T) * 4, "color is not tightly packed");
+	};
+
+	template<typename Elem>
+	binary_header make_binary_header(uint64_t count)
+	{
+		binary_header header{};
+		header.magic = binary_header::magic_value;
+		header.version = binary_header::current_version;
+		header.kind = binary_layout<Elem>::kind;
+		header.scalar = binary_layout<Elem>::scalar;
+		header.n = binary_layout<Elem>::n;
+		header.m = binary_layout<Elem>::m;
+		header.element_size = sizeof(Elem);
+		header.count = count;
+		header.data_offset = binary_header::data_alignment;
+		return header;
+	}
+
+	// Read only memory mapping of a whole file
+	class mapped_file
+	{
+	public:
+		mapped_file() = default;
+
+		explicit mapped_file(const std::string& path)
+		{
+#ifdef _WIN32
+			file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				throw std::runtime_error("gmath: cannot open " + path);
+
+			LARGE_INTEGER file_size{};
+			GetFileSizeEx(file, &file_size);
+			bytes = static_cast<size_t>(file_size.QuadPart);
+
+			if (bytes > 0)
+			{
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (!mapping)
+				{
+					close();
+					throw std::runtime_error("gmath: cannot map " + path);
+				}
+				data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				if (!data)
+				{
+					close();
+					throw std::runtime_error("gmath: cannot map " + path);
+				}
+			}
+#else
+			fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0)
+				throw std::runtime_error("gmath: cannot open " + path);
+
+			struct stat st{};
+			if (fstat(fd, &st) != 0)
+			{
+				close();
+				throw std::runtime_error("gmath: cannot stat " + path);
+			}
+			bytes = static_cast<size_t>(st.st_size);
+
+			if (bytes > 0)
+			{
+				void* address = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+				if (address == MAP_FAILED)
+				{
+					close();
+					throw std::runtime_error("gmath: cannot map " + path);
+				}
+				data = static_cast<const std::byte*>(address);
+				madvise(address, bytes, MADV_SEQUENTIAL);
+			}
+#endif
+		}
+
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		mapped_file(mapped_file&& other) noexcept
+		{
+			swap(other);
+		}
+
+		mapped_file& operator=(mapped_file&& other) noexcept
+		{
+			if (this != &other)
+			{
+				close();
+				swap(other);
+			}
+			return *this;
+		}
+
+		~mapped_file()
+		{
+			close();
+		}
+
+		const std::byte* begin() const { return data; }
+		size_t size() const { return bytes; }
+
+		void close()
+		{
+#ifdef _WIN32
+			if (data)
+				UnmapViewOfFile(data);
+			if (mapping)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+			mapping = nullptr;
+			file = INVALID_HANDLE_VALUE;
+#else
+			if (data)
+				munmap(const_cast<std::byte*>(data), bytes);
+			if (fd >= 0)
+				::close(fd);
+			fd = -1;
+#endif
+			data = nullptr;
+			bytes = 0;
+		}
+
+	private:
+		void swap(mapped_file& other)
+		{
+			std::swap(data, other.data);
+			std::swap(bytes, other.bytes);
+#ifdef _WIN32
+			std::swap(file, other.file);
+			std::swap(mapping, other.mapping);
+#else
+			std::swap(fd, other.fd);
+#endif
+		}
+
+		const std::byte* data{};
+		size_t bytes{};
+#ifdef _WIN32
+		HANDLE file{ INVALID_HANDLE_VALUE };
+		HANDLE mapping{};
+#else
+		int fd{ -1 };
+#endif
+	};
+
+	/*
+	* Maps a binary container and exposes the elements as spans pointing into the mapping.
+	* Throws std::runtime_error when the file is missing, truncated or of a newer version.
+	*/
+	class binary_reader
+	{
+	public:
+		explicit binary_reader(const std::string& path)
+			: file(path)
+		{
+			if (file.size() < sizeof(binary_header))
+				throw std::runtime_error("gmath: " + path + " is too small for a binary header");
+
+			std::memcpy(&header, file.begin(), sizeof(binary_header));
+			if (header.magic != binary_header::magic_value)
+				throw std::runtime_error("gmath: " + path + " is not a gmath binary file");
+			if (header.version > binary_header::current_version)
+				throw std::runtime_error("gmath: " + path + " has unsupported version " + std::to_string(header.version));
+			if (header.element_size == 0 || header.data_offset % binary_header::data_alignment != 0)
+				throw std::runtime_error("gmath: " + path + " has a corrupt header");
+			// Compared by division so a corrupt count cannot wrap the product around
+			if (header.data_offset > file.size() || header.count > (file.size() - header.data_offset) / header.element_size)
+				throw std::runtime_error("gmath: " + path + " is truncated");
+		}
+
+		const binary_header& info() const
+		{
+			return header;
+		}
+
+		size_t count() const
+		{
+			return static_cast<size_t>(header.count);
+		}
+
+		template<typename Elem>
+		bool holds() const
+		{
+			return header.kind == binary_layout<Elem>::kind && header.scalar == binary_layout<Elem>::scalar &&
+				header.n == binary_layout<Elem>::n && header.m == binary_layout<Elem>::m && header.element_size == sizeof(Elem);
+		}
+
+		// Zero copy view of the elements, throws std::runtime_error when Elem does not match the stored layout
+		template<typename Elem>
+		std::span<const Elem> view() const
+		{
+			if (!holds<Elem>())
+				throw std::runtime_error("gmath: binary element type mismatch");
+			return { reinterpret_cast<const Elem*>(file.begin() + header.data_offset), count() };
+		}
+
+	private:
+		mapped_file file;
+		binary_header header{};
+	};
+
+	/*
+	* Streams elements to a binary container without holding them in memory.
+	* The element count in the header is patched in close(), which also runs on destruction.
+	* write() and close() throw std::runtime_error when the stream fails, call close() to see errors of the last writes,
+	* the destructor cannot report them.
+	*/
+	template<typename Elem>
+	class binary_writer
+	{
+	public:
+		explicit binary_writer(const std::string& path)
+			: stream(path, std::ios::binary | std::ios::trunc)
+		{
+			if (!stream)
+				throw std::runtime_error("gmath: cannot create " + path);
+
+			binary_header header = make_binary_header<Elem>(0);
+			stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		}
+
+		binary_writer(const binary_writer&) = delete;
+		binary_writer& operator=(const binary_writer&) = delete;
+
+		~binary_writer()
+		{
+			try
+			{
+				close();
+			}
+			catch (...)
+			{
+			}
+		}
+
+		void write(const Elem& element)
+		{
+			write(&element, 1);
+		}
+
+		void write(const Elem* elements, size_t count)
+		{
+			stream.write(reinterpret_cast<const char*>(elements), static_cast<std::streamsize>(sizeof(Elem) * count));
+			if (!stream)
+				throw std::runtime_error("gmath: writing a binary file failed");
+			written += count;
+		}
+
+		void write(std::span<const Elem> elements)
+		{
+			write(elements.data(), elements.size());
+		}
+
+		size_t count() const
+		{
+			return static_cast<size_t>(written);
+		}
+
+		void close()
+		{
+			if (!stream.is_open())
+				return;
+
+			binary_header header = make_binary_header<Elem>(written);
+			stream.seekp(0);
+			stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			stream.close();
+			if (!stream)
+				throw std::runtime_error("gmath: finishing a binary file failed");
+		}
+
+	private:
+		std::ofstream stream;
+		uint64_t written{};
+	};
+}
\ No newline at end of file
@@ -124,12 +124,14 @@ namespace gmath
 		std::string to_string() const
 		{
 			std::stringstream ss;
-			ss << this;
+			ss << *this;
 			return ss.str();
 		}
 
 		color_base<T> grayscale() const
 		{
+			GMATH_PROFILE_SCOPE(color_grayscale);
+
 			long avg{ (r + g + b) / 3 };
 			T avg_t = static_cast<T>(avg);
 			color_base<T> result{ avg_t, avg_t, avg_t, a };
@@ -138,6 +140,8 @@ namespace gmath
 
 		static color_base<T> lerp(const color_base<T>& a, const color_base<T>& b, const float& t)
 		{
+			GMATH_PROFILE_SCOPE(color_lerp);
+
 			color_base<T> result{};
 			for (size_t i = 0; i < 4; i++)
 				result[i] = gmath::lerp(a[i], b[i], t);
@@ -177,6 +181,8 @@ namespace gmath
 	template<typename T>
 	color_base<T>& operator+=(color_base<T>& a, const color_base<T>& b)
 	{
+		GMATH_PROFILE_SCOPE(color_add);
+
 		for (size_t i = 0; i < 4; i++)
 			a[i] = static_cast<T>(gmath::clamp(static_cast<int>(a[i] + b[i]), 0, static_cast<int>(std::numeric_limits<T>::max())));
 		return a;
@@ -185,6 +191,8 @@ namespace gmath
 	template<typename T>
 	color_base<T>& operator-=(color_base<T>& a, const color_base<T>& b)
 	{
+		GMATH_PROFILE_SCOPE(color_subtract);
+
 		for (size_t i = 0; i < 4; i++)
 			a[i] = static_cast<T>(gmath::clamp(static_cast<int>(a[i] - b[i]), 0, static_cast<int>(std::numeric_limits<T>::max())));
 		return a;
@@ -193,6 +201,8 @@ namespace gmath
 	template<typename T>
 	color_base<T>& operator*=(color_base<T>& a, const color_base<T>& b)
 	{
+		GMATH_PROFILE_SCOPE(color_multiply);
+
 		for (size_t i = 0; i < 4; i++)
 			a[i] = static_cast<T>(gmath::clamp(static_cast<int>(a[i] * b[i]), 0, static_cast<int>(std::numeric_limits<T>::max())));
 		return a;
@@ -201,6 +211,8 @@ namespace gmath
 	template<typename T>
 	color_base<T>& operator/=(color_base<T>& a, const color_base<T>& b)
 	{
+		GMATH_PROFILE_SCOPE(color_divide);
+
 		for (size_t i = 0; i < 4; i++)
 			a[i] = static_cast<T>(gmath::clamp(static_cast<int>(a[i] / b[i]), 0, static_cast<int>(std::numeric_limits<T>::max())));
 		return a;
@@ -275,6 +287,21 @@ namespace gmath
 		return (stream << std::format("color({}, {}, {}, {})", static_cast<int>(c.r), static_cast<int>(c.g), static_cast<int>(c.b), static_cast<int>(c.a)));
 	}
 
+	namespace detail
+	{
+		// Truncates an already rounded value to a channel of T. The maximum of 32 and 64 bit channels is not exact in float
+		// and rounds up, so the value is clamped against it before the cast instead of after
+		template<typename T>
+		T channel_cast(double value)
+		{
+			if (!(value > 0.0))
+				return T(0);
+			if (value >= static_cast<double>(std::numeric_limits<T>::max()))
+				return std::numeric_limits<T>::max();
+			return static_cast<T>(value);
+		}
+	}
+
 	// Most commonly used color formats
 	using color = color_base<uint8_t>;
 	using color16 = color_base<uint16_t>;
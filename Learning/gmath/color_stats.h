@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "gmath.h"
+#include "color.h"
+#include "image.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace gmath
+{
+	/*
+	* Histograms and statistics over color_base pixels.
+	* Every chunk of the thread pool reduces into its own bins and accumulators, found through the chunk index of
+	* parallel_for, and the chunks are merged once at the end. Images are cut into rows, spans and one row images
+	* along x. Statistics run a register of pixels at a time in doubles, which hold 8 and 16 bit sums exactly.
+	*/
+
+	// Index of luminance after the red, green, blue and alpha channels
+	constexpr size_t luminance_channel = 4;
+
+	// Rec. 709 luminance in the units of the channels, unlike grayscale() it weighs green the most
+	template<typename T>
+	float luminance(const color_base<T>& c)
+	{
+		return 0.2126f * static_cast<float>(c.r) + 0.7152f * static_cast<float>(c.g) + 0.0722f * static_cast<float>(c.b);
+	}
+
+	struct channel_statistics
+	{
+		double min{};
+		double max{};
+		double mean{};
+		// Population variance, divided by the pixel count
+		double variance{};
+	};
+
+	struct color_statistics
+	{
+		// Red, green, blue, alpha and luminance
+		channel_statistics channels[5];
+		uint64_t count{};
+
+		const channel_statistics& luminance() const
+		{
+			return channels[luminance_channel];
+		}
+	};
+
+	struct color_histogram
+	{
+		size_t bins{};
+		// Channel values per bin, bin i covers [i * bin_width, (i + 1) * bin_width)
+		double bin_width{};
+		uint64_t count{};
+		// bins counts per channel, red, green, blue, alpha then luminance
+		std::vector<uint64_t> counts;
+
+		const uint64_t* channel(size_t c) const
+		{
+			return counts.data() + c * bins;
+		}
+
+		// Value below which a fraction p of the pixels lie, spreading the pixels of a bin evenly over its width
+		double percentile(size_t c, double p) const
+		{
+			if (count == 0)
+				return 0.0;
+
+			double target = std::clamp(p, 0.0, 1.0) * static_cast<double>(count);
+			const uint64_t* h = channel(c);
+			uint64_t below = 0;
+			for (size_t i = 0; i < bins; i++)
+			{
+				if (h[i] > 0 && static_cast<double>(below + h[i]) >= target)
+				{
+					double fraction = (target - static_cast<double>(below)) / static_cast<double>(h[i]);
+					return (static_cast<double>(i) + fraction) * bin_width;
+				}
+				below += h[i];
+			}
+			return static_cast<double>(bins) * bin_width;
+		}
+	};
+
+	namespace detail
+	{
+		// Runs accumulate(state, pixels, n) over runs of pixels with one state per parallel_for chunk
+		template<typename T, typename State, typename F>
+		std::vector<State> reduce_pixels(const image_view<const color_base<T>>& src, const State& init, F accumulate)
+		{
+			bool single_row = src.height == 1;
+			size_t units = single_row ? src.width : src.height;
+			size_t grain = get_parallel_config().batch_grain;
+			if (!single_row)
+				grain = std::max<size_t>(1, grain / std::max<size_t>(1, src.width));
+
+			std::vector<State> partial(units == 0 ? 0 : parallel_chunk_count(units, grain), init);
+			parallel_for(units, grain, [&](size_t chunk, size_t first, size_t last)
+			{
+				if (single_row)
+				{
+					accumulate(partial[chunk], src.row(0) + first, last - first);
+					return;
+				}
+				for (size_t y = first; y < last; y++)
+					accumulate(partial[chunk], src.row(y), src.width);
+			});
+			return partial;
+		}
+
+		struct statistics_state
+		{
+			double sum[5]{};
+			double squares[5]{};
+			double low[5];
+			double high[5];
+			uint64_t count{};
+
+			statistics_state()
+			{
+				std::fill(low, low + 5, std::numeric_limits<double>::infinity());
+				std::fill(high, high + 5, -std::numeric_limits<double>::infinity());
+			}
+		};
+
+		// Accumulates n pixels, W at a time, into state. The tail goes through W = 1
+		template<size_t W, typename T>
+		size_t accumulate_statistics(statistics_state& state, const color_base<T>* pixels, size_t n)
+		{
+			using V = simd<double, W>;
+			if (n < W)
+				return 0;
+
+			V sum[5], squares[5], low[5], high[5];
+			for (size_t c = 0; c < 5; c++)
+			{
+				sum[c] = squares[c] = V(0.0);
+				low[c] = V(std::numeric_limits<double>::infinity());
+				high[c] = V(-std::numeric_limits<double>::infinity());
+			}
+
+			size_t done = n / W * W;
+			for (size_t i = 0; i < done; i += W)
+			{
+				double values[4][W];
+				for (size_t l = 0; l < W; l++)
+				{
+					for (size_t c = 0; c < 4; c++)
+						values[c][l] = static_cast<double>(pixels[i + l][c]);
+				}
+
+				V x[5];
+				for (size_t c = 0; c < 4; c++)
+					x[c] = V::load(values[c]);
+				x[luminance_channel] = fma(x[0], V(0.2126), fma(x[1], V(0.7152), x[2] * V(0.0722)));
+				for (size_t c = 0; c < 5; c++)
+				{
+					sum[c] += x[c];
+					squares[c] = fma(x[c], x[c], squares[c]);
+					low[c] = min(low[c], x[c]);
+					high[c] = max(high[c], x[c]);
+				}
+			}
+
+			for (size_t c = 0; c < 5; c++)
+			{
+				state.sum[c] += reduce_add(sum[c]);
+				state.squares[c] += reduce_add(squares[c]);
+				state.low[c] = std::min(state.low[c], reduce_min(low[c]));
+				state.high[c] = std::max(state.high[c], reduce_max(high[c]));
+			}
+			state.count += done;
+			return done;
+		}
+	}
+
+	template<typename T>
+	color_statistics statistics(const std::type_identity_t<image_view<const color_base<T>>>& src)
+	{
+		constexpr size_t lanes = simd_native_width<double>();
+		std::vector<detail::statistics_state> partial = detail::reduce_pixels(src, detail::statistics_state{}, [](detail::statistics_state& state, const color_base<T>* pixels, size_t n)
+		{
+			size_t done = detail::accumulate_statistics<lanes>(state, pixels, n);
+			for (; done < n; done++)
+				detail::accumulate_statistics<1>(state, pixels + done, 1);
+		});
+
+		// Chunks are merged as (count, mean, squared deviations) so the variance never subtracts two large sums
+		color_statistics result;
+		double deviations[5]{};
+		for (const detail::statistics_state& state : partial)
+		{
+			if (state.count == 0)
+				continue;
+
+			double n = static_cast<double>(state.count);
+			double total = static_cast<double>(result.count + state.count);
+			for (size_t c = 0; c < 5; c++)
+			{
+				channel_statistics& s = result.channels[c];
+				double mean = state.sum[c] / n;
+				double squared = std::max(0.0, state.squares[c] - state.sum[c] * mean);
+				double delta = mean - s.mean;
+				deviations[c] += squared + delta * delta * static_cast<double>(result.count) * n / total;
+				s.mean += delta * n / total;
+				s.min = result.count == 0 ? state.low[c] : std::min(s.min, state.low[c]);
+				s.max = result.count == 0 ? state.high[c] : std::max(s.max, state.high[c]);
+			}
+			result.count += state.count;
+		}
+		for (size_t c = 0; c < 5 && result.count > 0; c++)
+			result.channels[c].variance = deviations[c] / static_cast<double>(result.count);
+		return result;
+	}
+
+	template<typename T>
+	color_statistics statistics(const color_base<T>* pixels, size_t count)
+	{
+		return statistics<T>(image_view<const color_base<T>>(pixels, count, 1));
+	}
+
+	/*
+	* Counts every channel and the luminance into bins equal parts of [0, max + 1), 256 bins on 8 bit colours are one
+	* value each. The per-chunk bins are summed in parallel over the bins, so the merge scales with the pool as well.
+	*/
+	template<typename T>
+	color_histogram histogram(const std::type_identity_t<image_view<const color_base<T>>>& src, size_t bins = 256)
+	{
+		static_assert(std::is_integral_v<T>, "histograms are built for integer colour types such as color and color16");
+		constexpr size_t lanes = simd_native_width<float>();
+		using V = simd<float, lanes>;
+
+		bins = std::max<size_t>(1, bins);
+		color_histogram result;
+		result.bins = bins;
+		result.bin_width = (static_cast<double>(std::numeric_limits<T>::max()) + 1.0) / static_cast<double>(bins);
+		result.count = src.width * src.height;
+		result.counts.assign(bins * 5, 0);
+
+		float scale = static_cast<float>(1.0 / result.bin_width);
+		float last_bin = static_cast<float>(bins - 1);
+		std::vector<std::vector<uint64_t>> partial = detail::reduce_pixels(src, std::vector<uint64_t>(), [&](std::vector<uint64_t>& counts, const color_base<T>* pixels, size_t n)
+		{
+			if (counts.empty())
+				counts.assign(bins * 5, 0);
+
+			// Bin indices are computed a register of pixels at a time, only the increments are scalar
+			float channels[5][lanes]{};
+			for (size_t i = 0; i < n; i += lanes)
+			{
+				size_t m = std::min(lanes, n - i);
+				for (size_t l = 0; l < m; l++)
+				{
+					for (size_t c = 0; c < 4; c++)
+						channels[c][l] = static_cast<float>(pixels[i + l][c]);
+				}
+
+				V x[4];
+				for (size_t c = 0; c < 4; c++)
+				{
+					x[c] = V::load(channels[c]);
+					min(floor(x[c] * V(scale)), V(last_bin)).store(channels[c]);
+				}
+				V y = fma(x[0], V(0.2126f), fma(x[1], V(0.7152f), x[2] * V(0.0722f)));
+				min(floor(y * V(scale)), V(last_bin)).store(channels[luminance_channel]);
+
+				for (size_t c = 0; c < 5; c++)
+				{
+					uint64_t* h = counts.data() + c * bins;
+					for (size_t l = 0; l < m; l++)
+						h[static_cast<size_t>(channels[c][l])]++;
+				}
+			}
+		});
+
+		parallel_for(result.counts.size(), 1024, [&](size_t first, size_t last)
+		{
+			for (const std::vector<uint64_t>& counts : partial)
+			{
+				if (counts.empty())
+					continue;
+				for (size_t i = first; i < last; i++)
+					result.counts[i] += counts[i];
+			}
+		});
+		return result;
+	}
+
+	template<typename T>
+	color_histogram histogram(const color_base<T>* pixels, size_t count, size_t bins = 256)
+	{
+		return histogram<T>(image_view<const color_base<T>>(pixels, count, 1), bins);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+/*
+* Runtime CPU feature detection.
+* Kernels for a higher tier than the compiler targets are marked with GMATH_TARGET, so one build carries every
+* implementation and kernels.h binds the best one for the running CPU. MSVC compiles intrinsics of any ISA without flags.
+*/
+
+#if defined(__GNUC__) || defined(__clang__)
+#define GMATH_TARGET(isa) __attribute__((target(isa)))
+#else
+#define GMATH_TARGET(isa)
+#endif
+
+#define GMATH_TARGET_SSE41 GMATH_TARGET("sse4.1")
+#define GMATH_TARGET_AVX2 GMATH_TARGET("avx2,fma")
+#define GMATH_TARGET_AVX512 GMATH_TARGET("avx512f,avx512bw,avx2,fma")
+
+namespace gmath
+{
+	struct cpu_features
+	{
+		bool sse2{};
+		bool sse41{};
+		bool avx{};
+		bool avx2{};
+		bool fma{};
+		bool avx512f{};
+		bool avx512bw{};
+	};
+
+	// Ordered, every tier implies the ones below it
+	enum class simd_tier : uint32_t
+	{
+		scalar,
+		sse2,
+		sse41,
+		avx2,   // AVX2 and FMA
+		avx512, // AVX-512 F and BW
+		count
+	};
+
+	inline const char* simd_tier_name(const simd_tier tier)
+	{
+		static const char* names[] = { "scalar", "sse2", "sse4.1", "avx2", "avx512" };
+		return names[static_cast<uint32_t>(tier)];
+	}
+
+	namespace detail
+	{
+		inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+		{
+#ifdef _MSC_VER
+			int values[4];
+			__cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+			std::memcpy(regs, values, sizeof(values));
+#else
+			__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		}
+
+		// Register state the OS saves on context switches, AVX needs XMM and YMM, AVX-512 also the opmask and ZMM state
+		inline uint64_t xgetbv()
+		{
+#ifdef _MSC_VER
+			return _xgetbv(0);
+#else
+			uint32_t lo, hi;
+			__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+			return (static_cast<uint64_t>(hi) << 32) | lo;
+#endif
+		}
+
+		inline cpu_features detect_cpu_features()
+		{
+			cpu_features features;
+			uint32_t regs[4];
+
+			cpuid(0, 0, regs);
+			uint32_t max_leaf = regs[0];
+			if (max_leaf < 1)
+				return features;
+
+			cpuid(1, 0, regs);
+			features.sse2 = (regs[3] >> 26) & 1;
+			features.sse41 = (regs[2] >> 19) & 1;
+			bool osxsave = (regs[2] >> 27) & 1;
+			bool avx = (regs[2] >> 28) & 1;
+			bool fma = (regs[2] >> 12) & 1;
+
+			uint64_t xcr0 = osxsave ? xgetbv() : 0;
+			bool ymm_state = (xcr0 & 0x6) == 0x6;
+			bool zmm_state = (xcr0 & 0xE6) == 0xE6;
+
+			features.avx = avx && ymm_state;
+			features.fma = fma && ymm_state;
+			if (max_leaf >= 7)
+			{
+				cpuid(7, 0, regs);
+				features.avx2 = features.avx && ((regs[1] >> 5) & 1);
+				features.avx512f = zmm_state && ((regs[1] >> 16) & 1);
+				features.avx512bw = features.avx512f && ((regs[1] >> 30) & 1);
+			}
+			return features;
+		}
+
+		inline bool parse_simd_tier(const char* name, simd_tier& tier)
+		{
+			for (uint32_t i = 0; i < static_cast<uint32_t>(simd_tier::count); i++)
+			{
+				if (std::strcmp(name, simd_tier_name(static_cast<simd_tier>(i))) == 0)
+				{
+					tier = static_cast<simd_tier>(i);
+					return true;
+				}
+			}
+			if (std::strcmp(name, "sse41") == 0)
+			{
+				tier = simd_tier::sse41;
+				return true;
+			}
+			return false;
+		}
+	}
+
+	inline const cpu_features& get_cpu_features()
+	{
+		static const cpu_features features = detail::detect_cpu_features();
+		return features;
+	}
+
+	// Best tier the CPU and OS support
+	inline simd_tier detected_simd_tier()
+	{
+		const cpu_features& f = get_cpu_features();
+		if (f.avx512f && f.avx512bw && f.avx2 && f.fma)
+			return simd_tier::avx512;
+		if (f.avx2 && f.fma)
+			return simd_tier::avx2;
+		if (f.sse41)
+			return simd_tier::sse41;
+		if (f.sse2)
+			return simd_tier::sse2;
+		return simd_tier::scalar;
+	}
+
+	/*
+	* Tier the kernels are bound to, decided once per process.
+	* GMATH_SIMD_TIER=scalar|sse2|sse4.1|avx2|avx512 forces a lower tier for testing, requests above the detected one are capped.
+	*/
+	inline simd_tier active_simd_tier()
+	{
+		static const simd_tier tier = []
+		{
+			simd_tier detected = detected_simd_tier();
+#ifdef _MSC_VER
+#pragma warning(suppress: 4996)
+#endif
+			const char* name = std::getenv("GMATH_SIMD_TIER");
+			simd_tier requested;
+			if (name && detail::parse_simd_tier(name, requested) && requested < detected)
+				return requested;
+			return detected;
+		}();
+		return tier;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "gmath.h"
+#include "vec.h"
+#include "color.h"
+#include "image.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace gmath
+{
+	/*
+	* Separable filters over color_base and vec4 images.
+	* Both passes filter rows: the first one reads the source rows and writes its result transposed into a float buffer,
+	* the second one filters the rows of that buffer, which are the source columns, and transposes back into the destination.
+	* Rows are filtered in blocks of 8 so the transposed writes go out as runs of 8 pixels, and blocks are spread over
+	* the thread pool. Channels stay interleaved as floats, so one register covers several RGBA pixels.
+	* Edges repeat the border pixel. The source is read completely before the destination is written, so they may be the same image.
+	*/
+
+	namespace detail
+	{
+		constexpr size_t filter_block = 8;
+
+		template<typename T>
+		void pixel_to_float(const color_base<T>& p, float* out)
+		{
+			for (size_t c = 0; c < 4; c++)
+				out[c] = static_cast<float>(p[c]);
+		}
+
+		inline void pixel_to_float(const vec4& p, float* out)
+		{
+			for (size_t c = 0; c < 4; c++)
+				out[c] = p[c];
+		}
+
+		template<typename T>
+		void float_to_pixel(const float* in, color_base<T>& p)
+		{
+			for (size_t c = 0; c < 4; c++)
+			{
+				if constexpr (std::is_integral_v<T>)
+					p[c] = channel_cast<T>(in[c] + 0.5f);
+				else
+					p[c] = static_cast<T>(in[c]);
+			}
+		}
+
+		inline void float_to_pixel(const float* in, vec4& p)
+		{
+			for (size_t c = 0; c < 4; c++)
+				p[c] = in[c];
+		}
+
+		// Copies the border pixel into the radius pixels before and after a row of length pixels that starts at row + radius * 4
+		inline void pad_row(float* row, size_t length, size_t radius)
+		{
+			float* first = row + radius * 4;
+			float* last = first + (length - 1) * 4;
+			for (size_t i = 0; i < radius; i++)
+			{
+				std::copy(first, first + 4, row + i * 4);
+				std::copy(last, last + 4, last + (i + 1) * 4);
+			}
+		}
+
+		/*
+		* Filters rows of length pixels. read(r, out) writes row r as floats, filter(padded, out) filters one padded row
+		* and write(r, n, block) takes the n filtered rows starting at r, stored one after the other.
+		*/
+		template<typename Read, typename Filter, typename Write>
+		void filter_rows(size_t rows, size_t length, size_t radius, Read read, Filter filter, Write write)
+		{
+			// Rows are over-allocated by a register so the filters can run full registers past the end
+			size_t padded_length = (length + 2 * radius) * 4 + simd_native_width<float>();
+			size_t row_length = length * 4 + simd_native_width<float>();
+			size_t grain = std::max<size_t>(filter_block, get_parallel_config().batch_grain / std::max<size_t>(1, length));
+
+			parallel_for(rows, grain, [&](size_t first, size_t last)
+			{
+				std::vector<float> padded(padded_length);
+				std::vector<float> block(filter_block * row_length);
+				for (size_t r = first; r < last; r += filter_block)
+				{
+					size_t n = std::min(filter_block, last - r);
+					for (size_t b = 0; b < n; b++)
+					{
+						read(r + b, padded.data() + radius * 4);
+						pad_row(padded.data(), length, radius);
+						filter(padded.data(), block.data() + b * row_length);
+					}
+					write(r, n, block.data(), row_length);
+				}
+			});
+		}
+
+		// out[i] = sum of taps[k] * padded[i + 4k] over the interleaved channels, a register of floats at a time
+		inline void convolve_row(const float* padded, float* out, size_t length, const std::vector<float>& taps)
+		{
+			constexpr size_t lanes = simd_native_width<float>();
+			using V = simd<float, lanes>;
+			for (size_t i = 0; i < length * 4; i += lanes)
+			{
+				V sum(0.0f);
+				for (size_t k = 0; k < taps.size(); k++)
+					sum = fma(V::load(padded + i + k * 4), V(taps[k]), sum);
+				sum.store(out + i);
+			}
+		}
+
+		/*
+		* Sliding window mean over 2 * radius + 1 pixels, one add and one subtract per channel and pixel whatever the radius.
+		* The running sums are doubles so they do not drift over long rows of 16 bit values.
+		*/
+		inline void box_row(const float* padded, float* out, size_t length, size_t radius)
+		{
+			using V = simd<double, 4>;
+			size_t window = 2 * radius + 1;
+			V scale(1.0 / static_cast<double>(window));
+
+			auto load = [](const float* p) { double d[4] = { p[0], p[1], p[2], p[3] }; return V::load(d); };
+			V sum(0.0);
+			for (size_t j = 0; j < window; j++)
+				sum += load(padded + j * 4);
+
+			double values[4];
+			for (size_t x = 0; x < length; x++)
+			{
+				(sum * scale).store(values);
+				for (size_t c = 0; c < 4; c++)
+					out[x * 4 + c] = static_cast<float>(values[c]);
+				if (x + 1 < length)
+					sum += load(padded + (x + window) * 4) - load(padded + x * 4);
+			}
+		}
+
+		// Runs filter_h over the rows of src into a transposed buffer, then filter_v over its rows back into dst
+		template<typename P, typename Horizontal, typename Vertical>
+		void separable(const image_view<const P>& src, const image_view<P>& dst, size_t radius_h, size_t radius_v, Horizontal filter_h, Vertical filter_v)
+		{
+			size_t width = std::min(src.width, dst.width);
+			size_t height = std::min(src.height, dst.height);
+			if (width == 0 || height == 0)
+				return;
+
+			// Column x of the image is row x of the buffer, height pixels of 4 floats
+			std::unique_ptr<float[]> transposed(new float[width * height * 4]);
+
+			filter_rows(height, width, radius_h,
+				[&](size_t y, float* out)
+				{
+					const P* row = src.row(y);
+					for (size_t x = 0; x < width; x++)
+						pixel_to_float(row[x], out + x * 4);
+				},
+				[&](const float* padded, float* out) { filter_h(padded, out, width); },
+				[&](size_t y, size_t n, const float* block, size_t stride)
+				{
+					for (size_t x = 0; x < width; x++)
+					{
+						float* column = transposed.get() + (x * height + y) * 4;
+						for (size_t b = 0; b < n; b++)
+							std::copy(block + b * stride + x * 4, block + b * stride + x * 4 + 4, column + b * 4);
+					}
+				});
+
+			filter_rows(width, height, radius_v,
+				[&](size_t x, float* out)
+				{
+					const float* column = transposed.get() + x * height * 4;
+					std::copy(column, column + height * 4, out);
+				},
+				[&](const float* padded, float* out) { filter_v(padded, out, height); },
+				[&](size_t x, size_t n, const float* block, size_t stride)
+				{
+					for (size_t y = 0; y < height; y++)
+					{
+						P* row = dst.row(y) + x;
+						for (size_t b = 0; b < n; b++)
+							float_to_pixel(block + b * stride + y * 4, row[b]);
+					}
+				});
+		}
+
+		inline void check_kernel(const std::vector<float>& kernel)
+		{
+			if (kernel.empty() || kernel.size() % 2 == 0)
+				throw std::runtime_error("gmath: convolution kernels need an odd number of taps");
+		}
+	}
+
+	// Normalized Gaussian taps out to 3 sigma
+	inline std::vector<float> gaussian_kernel(float sigma)
+	{
+		size_t radius = static_cast<size_t>(std::ceil(3.0f * std::max(sigma, 0.0f)));
+		std::vector<float> taps(radius * 2 + 1);
+		if (radius == 0)
+		{
+			taps[0] = 1.0f;
+			return taps;
+		}
+
+		double sum = 0.0;
+		for (size_t i = 0; i < taps.size(); i++)
+		{
+			double d = static_cast<double>(i) - static_cast<double>(radius);
+			taps[i] = static_cast<float>(std::exp(-d * d / (2.0 * sigma * sigma)));
+			sum += taps[i];
+		}
+		for (float& t : taps)
+			t = static_cast<float>(t / sum);
+		return taps;
+	}
+
+	// Convolves rows with horizontal and columns with vertical, both need an odd number of taps centred on the pixel
+	template<typename P>
+	void convolve_separable(const std::type_identity_t<image_view<const P>>& src, const image_view<P>& dst, const std::vector<float>& horizontal, const std::vector<float>& vertical)
+	{
+		detail::check_kernel(horizontal);
+		detail::check_kernel(vertical);
+		detail::separable<P>(src, dst, horizontal.size() / 2, vertical.size() / 2,
+			[&horizontal](const float* padded, float* out, size_t length) { detail::convolve_row(padded, out, length, horizontal); },
+			[&vertical](const float* padded, float* out, size_t length) { detail::convolve_row(padded, out, length, vertical); });
+	}
+
+	template<typename P>
+	void convolve_separable(const std::type_identity_t<image_view<const P>>& src, const image_view<P>& dst, const std::vector<float>& kernel)
+	{
+		convolve_separable<P>(src, dst, kernel, kernel);
+	}
+
+	template<typename P>
+	void gaussian_blur(const std::type_identity_t<image_view<const P>>& src, const image_view<P>& dst, float sigma)
+	{
+		convolve_separable<P>(src, dst, gaussian_kernel(sigma));
+	}
+
+	// Mean over a (2 * radius + 1)^2 square, the cost per pixel does not depend on the radius
+	template<typename P>
+	void box_blur(const std::type_identity_t<image_view<const P>>& src, const image_view<P>& dst, size_t radius)
+	{
+		auto filter = [radius](const float* padded, float* out, size_t length) { detail::box_row(padded, out, length, radius); };
+		detail::separable<P>(src, dst, radius, radius, filter, filter);
+	}
+}
\ No newline at end of file
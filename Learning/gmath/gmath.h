@@ -1,12 +1,15 @@
 #pragma once
 
 #include <math.h>
-#include <intrin.h>
-#include <xmmintrin.h>
-#include <pmmintrin.h>
+#include <cmath>
 #include <stdint.h>
 #include <chrono>
+#include <limits>
 #include <random>
+#include <type_traits>
+
+#include "profile.h"
+#include "simd.h"
 
 #define E						2.71828182845904523536   // e
 #define LOG2E					1.44269504088896340736   // log2(e)
@@ -82,44 +85,121 @@ namespace gmath
 		return min + fmod(value - min, max - min);
 	}
 
+	/*
+	* Precision policies pick the kernels behind sin, cos, atan, atan2 and sqrt at compile time.
+	* precision_fast keeps the cheap approximations (12 bit sqrt, ~3e-4 sin, ~1.5e-3 atan),
+	* precision_balanced refines them to about float precision and precision_exact uses the standard library.
+	* float defaults to fast and double to exact, pass a policy explicitly to override that.
+	*/
+
+	struct precision_fast {};
+	struct precision_balanced {};
+	struct precision_exact {};
+
+	template<typename T>
+	struct default_precision
+	{
+		using type = precision_fast;
+	};
+
+	template<>
+	struct default_precision<double>
+	{
+		using type = precision_exact;
+	};
+
+	template<>
+	struct default_precision<long double>
+	{
+		using type = precision_exact;
+	};
+
 	template<typename T>
+	using default_precision_t = typename default_precision<T>::type;
+
+	template<typename T, typename P = default_precision_t<T>>
 	T sin(T x)
 	{
-		const double A = 0.00735246819687011731341356165096815;
-		const double B = -0.16528911397014738207016302002888890;
-		const double C = 0.99969198629596757779830113868360584;
+		GMATH_PROFILE_SCOPE(sin);
+
+		if constexpr (std::is_same_v<P, precision_exact>)
+		{
+			return static_cast<T>(std::sin(x));
+		}
+		else
+		{
+			int32_t k;
+			double x2;
 
-		int32_t k;
-		double x2;
+			k = round(INVERSED_PI * x);
+			x -= k * PI;
+			x2 = static_cast<double>(x) * x;
 
-		k = round(INVERSED_PI * x);
-		x -= k * PI;
-		x2 = static_cast<double>(x) * x;
-		x = x * (C + x2 * (B + A * x2));
-		if (k % 2)
-			x = -x;
+			if constexpr (std::is_same_v<P, precision_balanced>)
+			{
+				// Taylor series up to x^11, below 6e-8 on [-pi/2, pi/2]
+				x = x * (1.0 + x2 * (-1.0 / 6.0 + x2 * (1.0 / 120.0 + x2 * (-1.0 / 5040.0 + x2 * (1.0 / 362880.0 + x2 * (-1.0 / 39916800.0))))));
+			}
+			else
+			{
+				const double A = 0.00735246819687011731341356165096815;
+				const double B = -0.16528911397014738207016302002888890;
+				const double C = 0.99969198629596757779830113868360584;
+
+				x = x * (C + x2 * (B + A * x2));
+			}
 
-		return x;
+			if (k % 2)
+				x = -x;
+
+			return x;
+		}
 	}
 
-	template<typename T>
+	template<typename T, typename P = default_precision_t<T>>
 	T cos(T x)
 	{
-		return sin<T>(HALF_PI - x);
+		if constexpr (std::is_same_v<P, precision_exact>)
+			return static_cast<T>(std::cos(x));
+		else
+			return sin<T, P>(HALF_PI - x);
 	}
 
-	template<typename T>
+	template<typename T, typename P = default_precision_t<T>>
 	T atan(T x)
 	{
-		return QUARTER_PI * x - x * (fabs(x) - 1.0) * (0.2447 + 0.0663 * fabs(x));
+		if constexpr (std::is_same_v<P, precision_exact>)
+		{
+			return static_cast<T>(std::atan(x));
+		}
+		else if constexpr (std::is_same_v<P, precision_balanced>)
+		{
+			// Abramowitz and Stegun 4.4.49, below 2e-8 on [-1, 1], larger inputs use atan(x) = +-pi/2 - atan(1/x)
+			bool inverted = fabs(x) > 1.0;
+			double a = inverted ? 1.0 / x : x;
+			double a2 = a * a;
+			a = a * (1.0 + a2 * (-0.3333314528 + a2 * (0.1999355085 + a2 * (-0.1420889944 + a2 * (0.1065626393 +
+				a2 * (-0.0752896400 + a2 * (0.0429096138 + a2 * (-0.0161657367 + a2 * 0.0028662257))))))));
+			if (inverted)
+				a = (x > 0.0 ? HALF_PI : -HALF_PI) - a;
+			return static_cast<T>(a);
+		}
+		else
+		{
+			return QUARTER_PI * x - x * (fabs(x) - 1.0) * (0.2447 + 0.0663 * fabs(x));
+		}
 	}
 
-	template<typename T>
+	template<typename T, typename P = default_precision_t<T>>
 	T atan2(const T& y, const T& x)
 	{
-		if (fabs(x) > fabs(y))
+		if constexpr (std::is_same_v<P, precision_exact>)
+		{
+			return static_cast<T>(std::atan2(y, x));
+		}
+		else if (fabs(x) > fabs(y))
 		{
-			T at = atan<T>(y / x);
+			T at = atan<T, P>(y / x);
 			if (x > 0.0)
 				return at;
 			else
@@ -127,7 +207,7 @@ namespace gmath
 		}
 		else
 		{
-			T at = atan<T>(x / y);
+			T at = atan<T, P>(x / y);
 			if (x > 0.0)
 				return y > 0.0 ? HALF_PI - at : -HALF_PI - at;
 			else
@@ -135,17 +215,86 @@ namespace gmath
 		}
 	}
 
-	template<typename T>
+	/*
+	* sqrt and rsqrt never touch the floating point control register. The estimates only cover normal floats, so zero,
+	* denormal and negative inputs are masked: sqrt returns 0 for them, rsqrt falls back to the exact result.
+	*/
+
+	template<typename T, typename P = default_precision_t<T>>
 	T sqrt(T x)
 	{
-		static int csr = 0;
-		if (!csr)
-			csr = _mm_getcsr() | 0x8040;
-		_mm_setcsr(csr);
-		return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x))) * x;
+		GMATH_PROFILE_SCOPE(sqrt);
+
+		if constexpr (std::is_same_v<P, precision_exact>)
+		{
+			return static_cast<T>(std::sqrt(x));
+		}
+		else if constexpr (std::is_same_v<P, precision_balanced>)
+		{
+			// One Newton-Raphson step on the 12 bit estimate gives ~23 bits
+			simd4f v(static_cast<float>(x));
+			simd4f r = rsqrt(v);
+			r = simd4f(0.5f) * r * (simd4f(3.0f) - v * r * r);
+			return static_cast<T>(select(v >= simd4f(std::numeric_limits<float>::min()), r * v, simd4f(0.0f))[0]);
+		}
+		else
+		{
+			simd4f v(static_cast<float>(x));
+			return static_cast<T>(select(v >= simd4f(std::numeric_limits<float>::min()), rsqrt(v), simd4f(0.0f))[0] * x);
+		}
+	}
+
+	// 1 / sqrt(x), the fast policy is the 12 bit hardware estimate and balanced adds a Newton-Raphson step
+	template<typename T, typename P = default_precision_t<T>>
+	T rsqrt(T x)
+	{
+		if constexpr (std::is_same_v<P, precision_exact>)
+		{
+			return static_cast<T>(1.0 / std::sqrt(x));
+		}
+		else
+		{
+			if (!(x >= std::numeric_limits<float>::min()))
+				return static_cast<T>(1.0 / std::sqrt(x));
+
+			simd4f v(static_cast<float>(x));
+			simd4f r = rsqrt(v);
+			if constexpr (std::is_same_v<P, precision_balanced>)
+				r = r * (simd4f(1.5f) - simd4f(0.5f) * v * r * r);
+			return static_cast<T>(r[0]);
+		}
 	}
 
-	int32_t round(double x)
+	/*
+	* Sets flush-to-zero and denormals-are-zero for the calling thread while it lives and restores the previous mode after.
+	* No gmath function needs it, it is for code that wants to keep denormals out of a whole batch on purpose.
+	*/
+	class denormal_guard
+	{
+	public:
+		denormal_guard()
+		{
+#ifdef GMATH_SIMD_SSE2
+			previous = _mm_getcsr();
+			_mm_setcsr(previous | 0x8040);
+#endif
+		}
+
+		~denormal_guard()
+		{
+#ifdef GMATH_SIMD_SSE2
+			_mm_setcsr(previous);
+#endif
+		}
+
+		denormal_guard(const denormal_guard&) = delete;
+		denormal_guard& operator=(const denormal_guard&) = delete;
+
+	private:
+		uint32_t previous{};
+	};
+
+	inline int32_t round(double x)
 	{
 		const double magic = 6755399441055744.0;
 
@@ -169,6 +318,8 @@ namespace gmath
 	template<typename T = float>
 	T random(const T& min = 0.0, const T& max = 1.0)
 	{
+		GMATH_PROFILE_SCOPE(random);
+
 		static std::random_device rd;
 		static std::mt19937 gen;
 		static bool gen_init{};
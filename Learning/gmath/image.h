@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace gmath
+{
+	/*
+	* Non-owning view of a 2D pixel buffer, stride is the distance between rows in pixels.
+	* P is usually a color_base or vector type, but any trivially copyable type works.
+	*/
+	template<typename P>
+	struct image_view
+	{
+		P* data{};
+		size_t width{};
+		size_t height{};
+		size_t stride{};
+
+		image_view() = default;
+
+		image_view(P* data, size_t width, size_t height)
+			: data(data), width(width), height(height), stride(width) {}
+
+		image_view(P* data, size_t width, size_t height, size_t stride)
+			: data(data), width(width), height(height), stride(stride) {}
+
+		operator image_view<const P>() const
+		{
+			return { data, width, height, stride };
+		}
+
+		P* row(const size_t y) const
+		{
+			return data + y * stride;
+		}
+
+		P& operator()(const size_t x, const size_t y) const
+		{
+			return data[y * stride + x];
+		}
+
+		image_view<P> sub(const size_t x, const size_t y, const size_t w, const size_t h) const
+		{
+			return { data + y * stride + x, w, h, stride };
+		}
+
+		size_t size() const
+		{
+			return width * height;
+		}
+	};
+
+	// Owning pixel buffer with tightly packed rows
+	template<typename P>
+	class image
+	{
+	public:
+		image() = default;
+
+		image(size_t width, size_t height)
+			: pixels(width * height), w(width), h(height) {}
+
+		image(size_t width, size_t height, const P& fill)
+			: pixels(width * height, fill), w(width), h(height) {}
+
+		void resize(size_t width, size_t height)
+		{
+			pixels.resize(width * height);
+			w = width;
+			h = height;
+		}
+
+		size_t width() const { return w; }
+		size_t height() const { return h; }
+		size_t size() const { return pixels.size(); }
+
+		P* data() { return pixels.data(); }
+		const P* data() const { return pixels.data(); }
+
+		P* row(const size_t y) { return pixels.data() + y * w; }
+		const P* row(const size_t y) const { return pixels.data() + y * w; }
+
+		P& operator()(const size_t x, const size_t y) { return pixels[y * w + x]; }
+		const P& operator()(const size_t x, const size_t y) const { return pixels[y * w + x]; }
+
+		image_view<P> view() { return { pixels.data(), w, h }; }
+		image_view<const P> view() const { return { pixels.data(), w, h }; }
+
+	private:
+		std::vector<P> pixels;
+		size_t w{};
+		size_t h{};
+	};
+}
\ No newline at end of file
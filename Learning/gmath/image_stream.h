@@ -0,0 +1,595 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "gmath.h"
+#include "color.h"
+#include "image.h"
+#include "kernels.h"
+#include "parallel.h"
+
+namespace gmath
+{
+	/*
+	* Layout of the pixels in a file, channels is 1 (gray), 2 (gray alpha), 3 (rgb) or 4 (rgba).
+	* Samples take one byte when maxval fits in 8 bits and two bytes otherwise.
+	*/
+	struct pixel_format
+	{
+		size_t width{};
+		size_t height{};
+		uint32_t channels{ 4 };
+		uint32_t maxval{ 255 };
+		bool big_endian{};
+
+		size_t sample_bytes() const
+		{
+			return maxval > 255 ? 2 : 1;
+		}
+
+		size_t pixel_bytes() const
+		{
+			return channels * sample_bytes();
+		}
+
+		size_t row_bytes() const
+		{
+			return width * pixel_bytes();
+		}
+	};
+
+	namespace detail
+	{
+		inline uint32_t load_sample(const std::byte* p, const pixel_format& format)
+		{
+			if (format.sample_bytes() == 1)
+				return static_cast<uint32_t>(p[0]);
+			uint32_t b0 = static_cast<uint32_t>(p[0]);
+			uint32_t b1 = static_cast<uint32_t>(p[1]);
+			return format.big_endian ? (b0 << 8) | b1 : (b1 << 8) | b0;
+		}
+
+		inline void store_sample(std::byte* p, const pixel_format& format, uint32_t value)
+		{
+			if (format.sample_bytes() == 1)
+			{
+				p[0] = static_cast<std::byte>(value);
+				return;
+			}
+			std::byte hi = static_cast<std::byte>(value >> 8);
+			std::byte lo = static_cast<std::byte>(value & 0xFF);
+			p[0] = format.big_endian ? hi : lo;
+			p[1] = format.big_endian ? lo : hi;
+		}
+
+		// Rounded rescale of value from [0, from] to [0, to]
+		template<typename T>
+		T rescale(uint64_t value, uint64_t from, uint64_t to)
+		{
+			if (from == to)
+				return static_cast<T>(value);
+			// value * to only fits in 64 bits when both ranges do in 32, 64 bit colours go through double
+			if (from <= std::numeric_limits<uint32_t>::max() && to <= std::numeric_limits<uint32_t>::max())
+				return static_cast<T>((value * to + from / 2) / from);
+			double scaled = static_cast<double>(value) * static_cast<double>(to) / static_cast<double>(from) + 0.5;
+			return scaled >= static_cast<double>(to) ? static_cast<T>(to) : static_cast<T>(scaled);
+		}
+
+		// Floor of the mean of three samples without overflowing for 64 bit channels
+		inline uint64_t average3(uint64_t a, uint64_t b, uint64_t c)
+		{
+			return a / 3 + b / 3 + c / 3 + (a % 3 + b % 3 + c % 3) / 3;
+		}
+
+		inline void read_token(std::istream& stream, std::string& token)
+		{
+			token.clear();
+			int c = stream.get();
+			while (c != EOF)
+			{
+				if (c == '#')
+				{
+					while (c != EOF && c != '\n')
+						c = stream.get();
+				}
+				else if (!std::isspace(c))
+				{
+					break;
+				}
+				c = stream.get();
+			}
+			while (c != EOF && !std::isspace(c))
+			{
+				token.push_back(static_cast<char>(c));
+				c = stream.get();
+			}
+		}
+
+		// Bounded queue of band indices handed between the reader, the workers and the writer
+		class band_queue
+		{
+		public:
+			static constexpr size_t end = std::numeric_limits<size_t>::max();
+
+			void push(size_t band)
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					bands.push(band);
+				}
+				ready.notify_one();
+			}
+
+			size_t pop()
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				ready.wait(lock, [this] { return !bands.empty(); });
+				size_t band = bands.front();
+				bands.pop();
+				return band;
+			}
+
+		private:
+			std::mutex mutex;
+			std::condition_variable ready;
+			std::queue<size_t> bands;
+		};
+	}
+
+	/*
+	* Format conversion between file samples and colors, the channel count and bit depth are converted on the fly.
+	*/
+
+	template<typename T>
+	void decode_pixels(const std::byte* src, const pixel_format& format, color_base<T>* dst, size_t count)
+	{
+		const uint64_t max = std::numeric_limits<T>::max();
+		const size_t step = format.sample_bytes();
+		for (size_t i = 0; i < count; i++, src += format.pixel_bytes())
+		{
+			T s[4]{};
+			for (uint32_t c = 0; c < format.channels; c++)
+				s[c] = detail::rescale<T>(detail::load_sample(src + c * step, format), format.maxval, max);
+
+			switch (format.channels)
+			{
+			case 1: dst[i] = { s[0], s[0], s[0], static_cast<T>(max) }; break;
+			case 2: dst[i] = { s[0], s[0], s[0], s[1] }; break;
+			case 3: dst[i] = { s[0], s[1], s[2], static_cast<T>(max) }; break;
+			default: dst[i] = { s[0], s[1], s[2], s[3] }; break;
+			}
+		}
+	}
+
+	template<typename T>
+	void encode_pixels(const color_base<T>* src, const pixel_format& format, std::byte* dst, size_t count)
+	{
+		const uint64_t max = std::numeric_limits<T>::max();
+		const size_t step = format.sample_bytes();
+		for (size_t i = 0; i < count; i++, dst += format.pixel_bytes())
+		{
+			const color_base<T>& c = src[i];
+			uint64_t s[4]{ c.r, c.g, c.b, c.a };
+			if (format.channels <= 2)
+			{
+				s[0] = detail::average3(c.r, c.g, c.b);
+				s[1] = c.a;
+			}
+			for (uint32_t ch = 0; ch < format.channels; ch++)
+				detail::store_sample(dst + ch * step, format, detail::rescale<uint32_t>(s[ch], max, format.maxval));
+		}
+	}
+
+	/*
+	* Band readers and writers, rows are transferred in file order as raw samples.
+	* Both throw std::runtime_error on malformed or truncated files.
+	*/
+
+	// Reads binary PGM (P5), PPM (P6) and PAM (P7) images
+	class pnm_reader
+	{
+	public:
+		explicit pnm_reader(const std::string& path)
+			: stream(path, std::ios::binary)
+		{
+			if (!stream)
+				throw std::runtime_error("gmath: cannot open " + path);
+
+			std::string token;
+			detail::read_token(stream, token);
+			if (token == "P5" || token == "P6")
+			{
+				fmt.channels = token == "P5" ? 1 : 3;
+				detail::read_token(stream, token);
+				fmt.width = std::stoull(token);
+				detail::read_token(stream, token);
+				fmt.height = std::stoull(token);
+				detail::read_token(stream, token);
+				fmt.maxval = static_cast<uint32_t>(std::stoul(token));
+			}
+			else if (token == "P7")
+			{
+				for (detail::read_token(stream, token); token != "ENDHDR"; detail::read_token(stream, token))
+				{
+					if (token.empty())
+						throw std::runtime_error("gmath: unterminated PAM header in " + path);
+
+					std::string value;
+					if (token == "TUPLTYPE")
+					{
+						std::getline(stream, value);
+						continue;
+					}
+					detail::read_token(stream, value);
+					if (token == "WIDTH")
+						fmt.width = std::stoull(value);
+					else if (token == "HEIGHT")
+						fmt.height = std::stoull(value);
+					else if (token == "DEPTH")
+						fmt.channels = static_cast<uint32_t>(std::stoul(value));
+					else if (token == "MAXVAL")
+						fmt.maxval = static_cast<uint32_t>(std::stoul(value));
+				}
+			}
+			else
+			{
+				throw std::runtime_error("gmath: " + path + " is not a binary PNM or PAM image");
+			}
+
+			if (fmt.channels < 1 || fmt.channels > 4 || fmt.maxval < 1 || fmt.maxval > 65535)
+				throw std::runtime_error("gmath: unsupported pixel layout in " + path);
+			fmt.big_endian = true;
+		}
+
+		const pixel_format& format() const
+		{
+			return fmt;
+		}
+
+		void read_rows(std::byte* dst, size_t rows)
+		{
+			stream.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(rows * fmt.row_bytes()));
+			if (!stream)
+				throw std::runtime_error("gmath: image data is truncated");
+		}
+
+	private:
+		std::ifstream stream;
+		pixel_format fmt{};
+	};
+
+	// Headerless samples in the given layout
+	class raw_reader
+	{
+	public:
+		raw_reader(const std::string& path, const pixel_format& format)
+			: stream(path, std::ios::binary), fmt(format)
+		{
+			if (!stream)
+				throw std::runtime_error("gmath: cannot open " + path);
+		}
+
+		const pixel_format& format() const
+		{
+			return fmt;
+		}
+
+		void read_rows(std::byte* dst, size_t rows)
+		{
+			stream.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(rows * fmt.row_bytes()));
+			if (!stream)
+				throw std::runtime_error("gmath: image data is truncated");
+		}
+
+	private:
+		std::ifstream stream;
+		pixel_format fmt;
+	};
+
+	// Writes PAM (P7) for any layout, or PGM/PPM when pam is false and the layout allows it
+	class pnm_writer
+	{
+	public:
+		pnm_writer(const std::string& path, pixel_format format, bool pam = true)
+			: stream(path, std::ios::binary | std::ios::trunc), fmt(format)
+		{
+			if (!stream)
+				throw std::runtime_error("gmath: cannot create " + path);
+
+			fmt.big_endian = true;
+			if (pam || fmt.channels == 2 || fmt.channels == 4)
+			{
+				const char* tuple_types[] = { "GRAYSCALE", "GRAYSCALE_ALPHA", "RGB", "RGB_ALPHA" };
+				stream << "P7\nWIDTH " << fmt.width << "\nHEIGHT " << fmt.height << "\nDEPTH " << fmt.channels
+					<< "\nMAXVAL " << fmt.maxval << "\nTUPLTYPE " << tuple_types[fmt.channels - 1] << "\nENDHDR\n";
+			}
+			else
+			{
+				stream << (fmt.channels == 1 ? "P5\n" : "P6\n") << fmt.width << " " << fmt.height << "\n" << fmt.maxval << "\n";
+			}
+		}
+
+		const pixel_format& format() const
+		{
+			return fmt;
+		}
+
+		void write_rows(const std::byte* src, size_t rows)
+		{
+			stream.write(reinterpret_cast<const char*>(src), static_cast<std::streamsize>(rows * fmt.row_bytes()));
+			if (!stream)
+				throw std::runtime_error("gmath: failed writing image data");
+		}
+
+	private:
+		std::ofstream stream;
+		pixel_format fmt;
+	};
+
+	class raw_writer
+	{
+	public:
+		raw_writer(const std::string& path, const pixel_format& format)
+			: stream(path, std::ios::binary | std::ios::trunc), fmt(format)
+		{
+			if (!stream)
+				throw std::runtime_error("gmath: cannot create " + path);
+		}
+
+		const pixel_format& format() const
+		{
+			return fmt;
+		}
+
+		void write_rows(const std::byte* src, size_t rows)
+		{
+			stream.write(reinterpret_cast<const char*>(src), static_cast<std::streamsize>(rows * fmt.row_bytes()));
+			if (!stream)
+				throw std::runtime_error("gmath: failed writing image data");
+		}
+
+	private:
+		std::ofstream stream;
+		pixel_format fmt;
+	};
+
+	/*
+	* Streams an image through a chain of per-pixel color stages in horizontal bands.
+	* Reading, processing and writing run concurrently on separate bands, so memory use is bounded by
+	* buffers * band_rows rows no matter how large the image is.
+	*/
+	template<typename T>
+	class image_pipeline
+	{
+	public:
+		using pixel = color_base<T>;
+		using stage = std::function<void(pixel*, size_t)>;
+
+		size_t band_rows{ 64 };
+		size_t buffers{ 3 };
+
+		// Appends a stage working on a contiguous run of pixels
+		image_pipeline<T>& then_span(stage s)
+		{
+			stages.push_back(std::move(s));
+			return *this;
+		}
+
+		// Appends a per-pixel stage, the loop is instantiated for fn so it is only called indirectly once per run
+		template<typename F>
+		image_pipeline<T>& then(F fn)
+		{
+			stages.push_back([fn](pixel* pixels, size_t count)
+			{
+				for (size_t i = 0; i < count; i++)
+					pixels[i] = fn(pixels[i]);
+			});
+			return *this;
+		}
+
+		// The built-in stages of 8 bit pipelines run the dispatched batch kernels of kernels.h
+		image_pipeline<T>& add(const pixel& c)
+		{
+			if constexpr (std::is_same_v<T, uint8_t>)
+				return then_span([c](pixel* pixels, size_t count) { color_add(pixels, c, pixels, count); });
+			else
+				return then([c](const pixel& p) { return p + c; });
+		}
+
+		image_pipeline<T>& subtract(const pixel& c)
+		{
+			if constexpr (std::is_same_v<T, uint8_t>)
+				return then_span([c](pixel* pixels, size_t count) { color_subtract(pixels, c, pixels, count); });
+			else
+				return then([c](const pixel& p) { return p - c; });
+		}
+
+		image_pipeline<T>& multiply(const pixel& c)
+		{
+			if constexpr (std::is_same_v<T, uint8_t>)
+				return then_span([c](pixel* pixels, size_t count) { color_multiply(pixels, c, pixels, count); });
+			else
+				return then([c](const pixel& p) { return p * c; });
+		}
+
+		image_pipeline<T>& divide(const pixel& c)
+		{
+			return then([c](const pixel& p) { return p / c; });
+		}
+
+		image_pipeline<T>& grayscale()
+		{
+			if constexpr (std::is_same_v<T, uint8_t>)
+				return then_span([](pixel* pixels, size_t count) { color_grayscale(pixels, pixels, count); });
+			else
+				return then([](const pixel& p) { return p.grayscale(); });
+		}
+
+		image_pipeline<T>& lerp(const pixel& target, const float& t)
+		{
+			return then([target, t](const pixel& p) { return pixel::lerp(p, target, t); });
+		}
+
+		// Applies the stages to an image that is already in memory
+		void process(image_view<pixel> view) const
+		{
+			parallel_for(view.height, grain_rows(view.width), [&](size_t first, size_t last)
+			{
+				for (size_t y = first; y < last; y++)
+				{
+					for (const stage& s : stages)
+						s(view.row(y), view.width);
+				}
+			});
+		}
+
+		/*
+		* Source needs format() and read_rows(std::byte*, size_t), Sink needs format() and write_rows(const std::byte*, size_t).
+		* Both must have the same dimensions, channel layout and bit depth are converted.
+		*/
+		template<typename Source, typename Sink>
+		void run(Source& source, Sink& sink) const
+		{
+			const pixel_format in = source.format();
+			const pixel_format out = sink.format();
+			if (in.width != out.width || in.height != out.height)
+				throw std::runtime_error("gmath: image_pipeline source and sink dimensions differ");
+
+			const size_t rows_per_band = std::max<size_t>(1, band_rows);
+			const size_t band_count = std::max<size_t>(2, buffers);
+
+			struct band
+			{
+				std::vector<std::byte> input;
+				std::vector<pixel> pixels;
+				std::vector<std::byte> output;
+				size_t rows{};
+			};
+
+			std::vector<band> bands(band_count);
+			for (band& b : bands)
+			{
+				b.input.resize(rows_per_band * in.row_bytes());
+				b.pixels.resize(rows_per_band * in.width);
+				b.output.resize(rows_per_band * out.row_bytes());
+			}
+
+			detail::band_queue free_bands, read_bands, processed_bands;
+			for (size_t i = 0; i < band_count; i++)
+				free_bands.push(i);
+
+			std::exception_ptr read_error, process_error, write_error;
+			std::atomic<bool> stopped{ false };
+
+			std::thread reader([&]
+			{
+				try
+				{
+					for (size_t row = 0; row < in.height; row += rows_per_band)
+					{
+						size_t i = free_bands.pop();
+						if (stopped)
+							break;
+						bands[i].rows = std::min(rows_per_band, in.height - row);
+						source.read_rows(bands[i].input.data(), bands[i].rows);
+						read_bands.push(i);
+					}
+				}
+				catch (...)
+				{
+					read_error = std::current_exception();
+				}
+				read_bands.push(detail::band_queue::end);
+			});
+
+			std::thread writer([&]
+			{
+				for (size_t i = processed_bands.pop(); i != detail::band_queue::end; i = processed_bands.pop())
+				{
+					// Keep draining after a failure so the reader never blocks on a full pipeline
+					if (!write_error)
+					{
+						try
+						{
+							sink.write_rows(bands[i].output.data(), bands[i].rows);
+						}
+						catch (...)
+						{
+							write_error = std::current_exception();
+						}
+					}
+					free_bands.push(i);
+				}
+			});
+
+			for (size_t i = read_bands.pop(); i != detail::band_queue::end; i = read_bands.pop())
+			{
+				try
+				{
+					process_band(bands[i].input.data(), in, bands[i].pixels.data(), bands[i].output.data(), out, bands[i].rows);
+				}
+				catch (...)
+				{
+					// Hand the band back so a reader waiting for a free band wakes up, sees the stop and ends
+					process_error = std::current_exception();
+					stopped = true;
+					free_bands.push(i);
+					break;
+				}
+				processed_bands.push(i);
+			}
+			processed_bands.push(detail::band_queue::end);
+
+			reader.join();
+			writer.join();
+
+			if (read_error)
+				std::rethrow_exception(read_error);
+			if (process_error)
+				std::rethrow_exception(process_error);
+			if (write_error)
+				std::rethrow_exception(write_error);
+		}
+
+	private:
+		// Rows per parallel chunk, so a chunk covers about as many pixels as the configured batch grain
+		static size_t grain_rows(size_t width)
+		{
+			return std::max<size_t>(1, get_parallel_config().batch_grain / std::max<size_t>(1, width));
+		}
+
+		// Splits a band into row ranges, each chunk decodes, runs every stage and encodes its rows while they are in cache
+		void process_band(const std::byte* input, const pixel_format& in, pixel* pixels, std::byte* output, const pixel_format& out, size_t rows) const
+		{
+			parallel_for(rows, grain_rows(in.width), [&](size_t first, size_t last)
+			{
+				for (size_t y = first; y < last; y++)
+				{
+					pixel* row = pixels + y * in.width;
+					decode_pixels(input + y * in.row_bytes(), in, row, in.width);
+					for (const stage& s : stages)
+						s(row, in.width);
+					encode_pixels(row, out, output + y * out.row_bytes(), in.width);
+				}
+			});
+		}
+
+		std::vector<stage> stages;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,924 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <type_traits>
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <immintrin.h>
+
+#include "gmath.h"
+#include "vec.h"
+#include "matrix.h"
+#include "color.h"
+#include "dispatch.h"
+#include "parallel.h"
+
+namespace gmath
+{
+	/*
+	* Batched kernels with one implementation per SIMD tier, bound once through function pointers (see dispatch.h).
+	* A tier without its own implementation of a kernel uses the best one below it.
+	* Source and destination may be the same array.
+	*/
+
+	namespace detail
+	{
+		constexpr float sincos_pi_a = 3.140625f;
+		constexpr float sincos_pi_b = 0.0009670257568359375f;
+		constexpr float sincos_pi_c = 6.2771141529083251953e-7f;
+
+		/*
+		* sin and cos reduce x to r in [-pi/2, pi/2] with a three part pi, exact for |x| < 1e5, and evaluate the Taylor
+		* series of sin up to r^11. Errors stay below 5e-7 over that range in every tier.
+		*/
+		template<bool Cosine>
+		float sincos1(float x)
+		{
+			float k = Cosine ? std::nearbyint(x * static_cast<float>(INVERSED_PI) - 0.5f) : std::nearbyint(x * static_cast<float>(INVERSED_PI));
+			int32_t parity = static_cast<int32_t>(k) + (Cosine ? 1 : 0);
+			if (Cosine)
+				k += 0.5f;
+			float r = ((x - k * sincos_pi_a) - k * sincos_pi_b) - k * sincos_pi_c;
+			float r2 = r * r;
+			float s = r * (1.0f + r2 * (-1.0f / 6.0f + r2 * (1.0f / 120.0f + r2 * (-1.0f / 5040.0f + r2 * (1.0f / 362880.0f + r2 * (-1.0f / 39916800.0f))))));
+			return parity & 1 ? -s : s;
+		}
+
+		inline uint32_t color_bits(const color& c)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, c.data, sizeof(bits));
+			return bits;
+		}
+
+		/*
+		* Scalar
+		*/
+
+		inline void transform_scalar(const mat4& m, const vec4* src, vec4* dst, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const vec4 r = transform(m, src[i]);
+				for (size_t d = 0; d < 4; d++)
+					dst[i][d] = r[d];
+			}
+		}
+
+		inline void transform_points_scalar(const mat4& m, const vec3* src, vec3* dst, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const vec3 r = transform_point(m, src[i]);
+				for (size_t d = 0; d < 3; d++)
+					dst[i][d] = r[d];
+			}
+		}
+
+		inline void color_add_scalar(const color* src, const color& c, color* dst, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				dst[i] = src[i] + c;
+		}
+
+		inline void color_subtract_scalar(const color* src, const color& c, color* dst, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				dst[i] = src[i] - c;
+		}
+
+		inline void color_multiply_scalar(const color* src, const color& c, color* dst, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				dst[i] = src[i] * c;
+		}
+
+		inline void color_grayscale_scalar(const color* src, color* dst, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				dst[i] = src[i].grayscale();
+		}
+
+		template<bool Cosine>
+		void sincos_scalar(const float* src, float* dst, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				dst[i] = sincos1<Cosine>(src[i]);
+		}
+
+		// The scalar tier has no estimate instruction, so every precision is computed exactly. Approximate square roots
+		// still give 0 below the smallest normal float and for negative inputs, like the other tiers
+		inline void sqrt_scalar(const float* src, float* dst, size_t count, int32_t steps)
+		{
+			for (size_t i = 0; i < count; i++)
+				dst[i] = steps < 0 || src[i] >= std::numeric_limits<float>::min() ? std::sqrt(src[i]) : 0.0f;
+		}
+
+		inline void rsqrt_scalar(const float* src, float* dst, size_t count, int32_t)
+		{
+			for (size_t i = 0; i < count; i++)
+				dst[i] = 1.0f / std::sqrt(src[i]);
+		}
+
+		template<size_t N>
+		void normalize_scalar(const vector<float, N>* src, vector<float, N>* dst, size_t count, int32_t)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				float sqr = src[i].sqr_magnitude();
+				float scale = sqr > 0.0f ? 1.0f / std::sqrt(sqr) : 0.0f;
+				for (size_t d = 0; d < N; d++)
+					dst[i][d] = src[i][d] * scale;
+			}
+		}
+
+		/*
+		* SSE2
+		*/
+
+		inline void transform_sse2(const mat4& m, const vec4* src, vec4* dst, size_t count)
+		{
+			__m128 r0 = _mm_loadu_ps(m.elements);
+			__m128 r1 = _mm_loadu_ps(m.elements + 4);
+			__m128 r2 = _mm_loadu_ps(m.elements + 8);
+			__m128 r3 = _mm_loadu_ps(m.elements + 12);
+			for (size_t i = 0; i < count; i++)
+			{
+				__m128 v = _mm_loadu_ps(src[i].data);
+				__m128 r = _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), r0);
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0x55), r1));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xAA), r2));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xFF), r3));
+				_mm_storeu_ps(dst[i].data, r);
+			}
+		}
+
+		inline void transform_points_sse2(const mat4& m, const vec3* src, vec3* dst, size_t count)
+		{
+			__m128 r0 = _mm_loadu_ps(m.elements);
+			__m128 r1 = _mm_loadu_ps(m.elements + 4);
+			__m128 r2 = _mm_loadu_ps(m.elements + 8);
+			__m128 r3 = _mm_loadu_ps(m.elements + 12);
+			for (size_t i = 0; i < count; i++)
+			{
+				__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(src[i].x), r0), _mm_mul_ps(_mm_set1_ps(src[i].y), r1));
+				r = _mm_add_ps(_mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(src[i].z), r2)), r3);
+				// Three floats only, a 16 byte store would run past the last point
+				_mm_storel_pi(reinterpret_cast<__m64*>(dst[i].data), r);
+				dst[i].z = _mm_cvtss_f32(_mm_movehl_ps(r, r));
+			}
+		}
+
+		inline void color_add_sse2(const color* src, const color& c, color* dst, size_t count)
+		{
+			__m128i cv = _mm_set1_epi32(static_cast<int>(color_bits(c)));
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), cv));
+			color_add_scalar(src + i, c, dst + i, count - i);
+		}
+
+		inline void color_subtract_sse2(const color* src, const color& c, color* dst, size_t count)
+		{
+			__m128i cv = _mm_set1_epi32(static_cast<int>(color_bits(c)));
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_subs_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), cv));
+			color_subtract_scalar(src + i, c, dst + i, count - i);
+		}
+
+		// The 16 bit products are clamped to 255 by x - max(x - 255, 0), SSE2 has no unsigned 16 bit min
+		inline void color_multiply_sse2(const color* src, const color& c, color* dst, size_t count)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i max = _mm_set1_epi16(255);
+			__m128i cw = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color_bits(c))), zero);
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), cw);
+				__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), cw);
+				lo = _mm_sub_epi16(lo, _mm_subs_epu16(lo, max));
+				hi = _mm_sub_epi16(hi, _mm_subs_epu16(hi, max));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+			}
+			color_multiply_scalar(src + i, c, dst + i, count - i);
+		}
+
+		// (r + g + b) / 3 as (sum * 0xAAAB) >> 17, exact for sums up to 765
+		inline void color_grayscale_sse2(const color* src, color* dst, size_t count)
+		{
+			const __m128i mask = _mm_set1_epi32(0xFF);
+			const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+			const __m128i third = _mm_set1_epi32(0xAAAB);
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(v, mask), _mm_and_si128(_mm_srli_epi32(v, 8), mask)), _mm_and_si128(_mm_srli_epi32(v, 16), mask));
+				__m128i avg = _mm_srli_epi32(_mm_mulhi_epu16(sum, third), 1);
+				__m128i gray = _mm_or_si128(_mm_or_si128(avg, _mm_slli_epi32(avg, 8)), _mm_slli_epi32(avg, 16));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(gray, _mm_and_si128(v, alpha)));
+			}
+			color_grayscale_scalar(src + i, dst + i, count - i);
+		}
+
+		template<bool Cosine>
+		void sincos_sse2(const float* src, float* dst, size_t count)
+		{
+			const __m128 inv_pi = _mm_set1_ps(static_cast<float>(INVERSED_PI));
+			const __m128 half = _mm_set1_ps(0.5f);
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(src + i);
+				__m128 k = _mm_mul_ps(x, inv_pi);
+				if (Cosine)
+					k = _mm_sub_ps(k, half);
+				__m128i ki = _mm_cvtps_epi32(k);
+				k = _mm_cvtepi32_ps(ki);
+				if (Cosine)
+				{
+					k = _mm_add_ps(k, half);
+					ki = _mm_add_epi32(ki, _mm_set1_epi32(1));
+				}
+
+				__m128 r = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(sincos_pi_a)));
+				r = _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(sincos_pi_b)));
+				r = _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(sincos_pi_c)));
+				__m128 r2 = _mm_mul_ps(r, r);
+
+				__m128 p = _mm_add_ps(_mm_set1_ps(1.0f / 362880.0f), _mm_mul_ps(r2, _mm_set1_ps(-1.0f / 39916800.0f)));
+				p = _mm_add_ps(_mm_set1_ps(-1.0f / 5040.0f), _mm_mul_ps(r2, p));
+				p = _mm_add_ps(_mm_set1_ps(1.0f / 120.0f), _mm_mul_ps(r2, p));
+				p = _mm_add_ps(_mm_set1_ps(-1.0f / 6.0f), _mm_mul_ps(r2, p));
+				p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, p));
+
+				__m128 sign = _mm_castsi128_ps(_mm_slli_epi32(ki, 31));
+				_mm_storeu_ps(dst + i, _mm_xor_ps(_mm_mul_ps(r, p), sign));
+			}
+			sincos_scalar<Cosine>(src + i, dst + i, count - i);
+		}
+
+		/*
+		* Newton-Raphson steps y * (1.5 - 0.5 * x * y^2) on the hardware estimate, each one about doubles its bits.
+		* The estimate only covers normal floats, lanes below the smallest normal float take the exact result
+		* for rsqrt and 0 for sqrt. Negative steps use the correctly rounded instructions instead.
+		* The last count % W elements go through one zero padded register of the same tier, so every element of
+		* a batch gets the same result no matter where it sits.
+		*/
+		inline __m128 rsqrt_estimate_sse2(__m128 x, int32_t steps)
+		{
+			__m128 y = _mm_rsqrt_ps(x);
+			__m128 half_x = _mm_mul_ps(x, _mm_set1_ps(0.5f));
+			for (int32_t s = 0; s < steps; s++)
+				y = _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(half_x, _mm_mul_ps(y, y))));
+			return y;
+		}
+
+		inline __m128 rsqrt_sse2(__m128 x, int32_t steps)
+		{
+			__m128 exact = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(x));
+			if (steps < 0)
+				return exact;
+			__m128 normal = _mm_cmpge_ps(x, _mm_set1_ps(std::numeric_limits<float>::min()));
+			__m128 y = rsqrt_estimate_sse2(x, steps);
+			return _mm_or_ps(_mm_and_ps(normal, y), _mm_andnot_ps(normal, exact));
+		}
+
+		inline void sqrt_sse2(const float* src, float* dst, size_t count, int32_t steps)
+		{
+			const __m128 smallest = _mm_set1_ps(std::numeric_limits<float>::min());
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(src + i);
+				__m128 r = steps < 0 ? _mm_sqrt_ps(x) : _mm_and_ps(_mm_cmpge_ps(x, smallest), _mm_mul_ps(x, rsqrt_estimate_sse2(x, steps)));
+				_mm_storeu_ps(dst + i, r);
+			}
+			if (i < count)
+			{
+				alignas(16) float tail[4]{};
+				std::copy(src + i, src + count, tail);
+				sqrt_sse2(tail, tail, 4, steps);
+				std::copy(tail, tail + (count - i), dst + i);
+			}
+		}
+
+		inline void rsqrt_sse2(const float* src, float* dst, size_t count, int32_t steps)
+		{
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_ps(dst + i, rsqrt_sse2(_mm_loadu_ps(src + i), steps));
+			if (i < count)
+			{
+				alignas(16) float tail[4]{};
+				std::copy(src + i, src + count, tail);
+				rsqrt_sse2(tail, tail, 4, steps);
+				std::copy(tail, tail + (count - i), dst + i);
+			}
+		}
+
+		// Zero vectors stay zero, the shortest others fall back to the exact rsqrt like vector::normalize
+		template<size_t N>
+		void normalize_sse2(const vector<float, N>* src, vector<float, N>* dst, size_t count, int32_t steps)
+		{
+			for (size_t i = 0; i < count; i += 4)
+			{
+				size_t n = std::min<size_t>(4, count - i);
+				alignas(16) float scale[4]{};
+				for (size_t l = 0; l < n; l++)
+					scale[l] = src[i + l].sqr_magnitude();
+				__m128 sqr = _mm_load_ps(scale);
+				_mm_store_ps(scale, _mm_and_ps(_mm_cmpgt_ps(sqr, _mm_setzero_ps()), rsqrt_sse2(sqr, steps)));
+				for (size_t l = 0; l < n; l++)
+				{
+					for (size_t d = 0; d < N; d++)
+						dst[i + l][d] = src[i + l][d] * scale[l];
+				}
+			}
+		}
+
+		/*
+		* SSE4.1
+		*/
+
+		GMATH_TARGET_SSE41 inline void color_multiply_sse41(const color* src, const color& c, color* dst, size_t count)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i max = _mm_set1_epi16(255);
+			__m128i cw = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color_bits(c))), zero);
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i lo = _mm_min_epu16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), cw), max);
+				__m128i hi = _mm_min_epu16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), cw), max);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+			}
+			color_multiply_scalar(src + i, c, dst + i, count - i);
+		}
+
+		/*
+		* AVX2 and FMA
+		*/
+
+		GMATH_TARGET_AVX2 inline void transform_avx2(const mat4& m, const vec4* src, vec4* dst, size_t count)
+		{
+			__m256 r0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.elements));
+			__m256 r1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.elements + 4));
+			__m256 r2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.elements + 8));
+			__m256 r3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m.elements + 12));
+			size_t i = 0;
+			for (; i + 2 <= count; i += 2)
+			{
+				__m256 v = _mm256_loadu_ps(src[i].data);
+				__m256 r = _mm256_mul_ps(_mm256_permute_ps(v, 0x00), r0);
+				r = _mm256_fmadd_ps(_mm256_permute_ps(v, 0x55), r1, r);
+				r = _mm256_fmadd_ps(_mm256_permute_ps(v, 0xAA), r2, r);
+				r = _mm256_fmadd_ps(_mm256_permute_ps(v, 0xFF), r3, r);
+				_mm256_storeu_ps(dst[i].data, r);
+			}
+			transform_sse2(m, src + i, dst + i, count - i);
+		}
+
+		// Eight points are transposed to x, y and z registers, transformed and transposed back
+		GMATH_TARGET_AVX2 inline void transform_points_avx2(const mat4& m, const vec3* src, vec3* dst, size_t count)
+		{
+			__m256 e[12];
+			for (size_t j = 0; j < 3; j++)
+			{
+				for (size_t k = 0; k < 4; k++)
+					e[j * 4 + k] = _mm256_set1_ps(m.elements[k * 4 + j]);
+			}
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				const float* p = src[i].data;
+				__m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+				__m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+				__m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+
+				__m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+				__m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+				__m256 x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+				__m256 y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+				__m256 z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+
+				__m256 ox = _mm256_fmadd_ps(z, e[2], _mm256_fmadd_ps(y, e[1], _mm256_fmadd_ps(x, e[0], e[3])));
+				__m256 oy = _mm256_fmadd_ps(z, e[6], _mm256_fmadd_ps(y, e[5], _mm256_fmadd_ps(x, e[4], e[7])));
+				__m256 oz = _mm256_fmadd_ps(z, e[10], _mm256_fmadd_ps(y, e[9], _mm256_fmadd_ps(x, e[8], e[11])));
+
+				__m256 rxy = _mm256_shuffle_ps(ox, oy, _MM_SHUFFLE(2, 0, 2, 0));
+				__m256 ryz = _mm256_shuffle_ps(oy, oz, _MM_SHUFFLE(3, 1, 3, 1));
+				__m256 rzx = _mm256_shuffle_ps(oz, ox, _MM_SHUFFLE(3, 1, 2, 0));
+				__m256 r03 = _mm256_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0));
+				__m256 r14 = _mm256_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0));
+				__m256 r25 = _mm256_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1));
+
+				float* q = dst[i].data;
+				_mm_storeu_ps(q, _mm256_castps256_ps128(r03));
+				_mm_storeu_ps(q + 4, _mm256_castps256_ps128(r14));
+				_mm_storeu_ps(q + 8, _mm256_castps256_ps128(r25));
+				_mm_storeu_ps(q + 12, _mm256_extractf128_ps(r03, 1));
+				_mm_storeu_ps(q + 16, _mm256_extractf128_ps(r14, 1));
+				_mm_storeu_ps(q + 20, _mm256_extractf128_ps(r25, 1));
+			}
+			transform_points_sse2(m, src + i, dst + i, count - i);
+		}
+
+		GMATH_TARGET_AVX2 inline void color_add_avx2(const color* src, const color& c, color* dst, size_t count)
+		{
+			__m256i cv = _mm256_set1_epi32(static_cast<int>(color_bits(c)));
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_adds_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), cv));
+			color_add_sse2(src + i, c, dst + i, count - i);
+		}
+
+		GMATH_TARGET_AVX2 inline void color_subtract_avx2(const color* src, const color& c, color* dst, size_t count)
+		{
+			__m256i cv = _mm256_set1_epi32(static_cast<int>(color_bits(c)));
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_subs_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), cv));
+			color_subtract_sse2(src + i, c, dst + i, count - i);
+		}
+
+		// Unpacking and packing both work per 128 bit lane, so the pixel order survives the round trip
+		GMATH_TARGET_AVX2 inline void color_multiply_avx2(const color* src, const color& c, color* dst, size_t count)
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i max = _mm256_set1_epi16(255);
+			__m256i cw = _mm256_unpacklo_epi8(_mm256_set1_epi32(static_cast<int>(color_bits(c))), zero);
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+				__m256i lo = _mm256_min_epu16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(v, zero), cw), max);
+				__m256i hi = _mm256_min_epu16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(v, zero), cw), max);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+			}
+			color_multiply_sse41(src + i, c, dst + i, count - i);
+		}
+
+		GMATH_TARGET_AVX2 inline void color_grayscale_avx2(const color* src, color* dst, size_t count)
+		{
+			const __m256i mask = _mm256_set1_epi32(0xFF);
+			const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+			const __m256i third = _mm256_set1_epi32(0xAAAB);
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+				__m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_and_si256(v, mask), _mm256_and_si256(_mm256_srli_epi32(v, 8), mask)), _mm256_and_si256(_mm256_srli_epi32(v, 16), mask));
+				__m256i avg = _mm256_srli_epi32(_mm256_mulhi_epu16(sum, third), 1);
+				__m256i gray = _mm256_or_si256(_mm256_or_si256(avg, _mm256_slli_epi32(avg, 8)), _mm256_slli_epi32(avg, 16));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(gray, _mm256_and_si256(v, alpha)));
+			}
+			color_grayscale_sse2(src + i, dst + i, count - i);
+		}
+
+		template<bool Cosine>
+		GMATH_TARGET_AVX2 void sincos_avx2(const float* src, float* dst, size_t count)
+		{
+			const __m256 inv_pi = _mm256_set1_ps(static_cast<float>(INVERSED_PI));
+			const __m256 half = _mm256_set1_ps(0.5f);
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 x = _mm256_loadu_ps(src + i);
+				__m256 k = _mm256_mul_ps(x, inv_pi);
+				if (Cosine)
+					k = _mm256_sub_ps(k, half);
+				__m256i ki = _mm256_cvtps_epi32(k);
+				k = _mm256_cvtepi32_ps(ki);
+				if (Cosine)
+				{
+					k = _mm256_add_ps(k, half);
+					ki = _mm256_add_epi32(ki, _mm256_set1_epi32(1));
+				}
+
+				__m256 r = _mm256_fnmadd_ps(k, _mm256_set1_ps(sincos_pi_a), x);
+				r = _mm256_fnmadd_ps(k, _mm256_set1_ps(sincos_pi_b), r);
+				r = _mm256_fnmadd_ps(k, _mm256_set1_ps(sincos_pi_c), r);
+				__m256 r2 = _mm256_mul_ps(r, r);
+
+				__m256 p = _mm256_fmadd_ps(r2, _mm256_set1_ps(-1.0f / 39916800.0f), _mm256_set1_ps(1.0f / 362880.0f));
+				p = _mm256_fmadd_ps(r2, p, _mm256_set1_ps(-1.0f / 5040.0f));
+				p = _mm256_fmadd_ps(r2, p, _mm256_set1_ps(1.0f / 120.0f));
+				p = _mm256_fmadd_ps(r2, p, _mm256_set1_ps(-1.0f / 6.0f));
+				p = _mm256_fmadd_ps(r2, p, _mm256_set1_ps(1.0f));
+
+				__m256 sign = _mm256_castsi256_ps(_mm256_slli_epi32(ki, 31));
+				_mm256_storeu_ps(dst + i, _mm256_xor_ps(_mm256_mul_ps(r, p), sign));
+			}
+			sincos_sse2<Cosine>(src + i, dst + i, count - i);
+		}
+
+		GMATH_TARGET_AVX2 inline __m256 rsqrt_avx2(__m256 x, int32_t steps)
+		{
+			__m256 exact = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(x));
+			if (steps < 0)
+				return exact;
+			__m256 y = _mm256_rsqrt_ps(x);
+			__m256 half_x = _mm256_mul_ps(x, _mm256_set1_ps(0.5f));
+			for (int32_t s = 0; s < steps; s++)
+				y = _mm256_mul_ps(y, _mm256_fnmadd_ps(half_x, _mm256_mul_ps(y, y), _mm256_set1_ps(1.5f)));
+			__m256 normal = _mm256_cmp_ps(x, _mm256_set1_ps(std::numeric_limits<float>::min()), _CMP_GE_OQ);
+			return _mm256_blendv_ps(exact, y, normal);
+		}
+
+		GMATH_TARGET_AVX2 inline void sqrt_avx2(const float* src, float* dst, size_t count, int32_t steps)
+		{
+			const __m256 smallest = _mm256_set1_ps(std::numeric_limits<float>::min());
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 x = _mm256_loadu_ps(src + i);
+				__m256 r = steps < 0 ? _mm256_sqrt_ps(x) : _mm256_and_ps(_mm256_cmp_ps(x, smallest, _CMP_GE_OQ), _mm256_mul_ps(x, rsqrt_avx2(x, steps)));
+				_mm256_storeu_ps(dst + i, r);
+			}
+			if (i < count)
+			{
+				alignas(32) float tail[8]{};
+				std::copy(src + i, src + count, tail);
+				sqrt_avx2(tail, tail, 8, steps);
+				std::copy(tail, tail + (count - i), dst + i);
+			}
+		}
+
+		GMATH_TARGET_AVX2 inline void rsqrt_avx2(const float* src, float* dst, size_t count, int32_t steps)
+		{
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+				_mm256_storeu_ps(dst + i, rsqrt_avx2(_mm256_loadu_ps(src + i), steps));
+			if (i < count)
+			{
+				alignas(32) float tail[8]{};
+				std::copy(src + i, src + count, tail);
+				rsqrt_avx2(tail, tail, 8, steps);
+				std::copy(tail, tail + (count - i), dst + i);
+			}
+		}
+
+		template<size_t N>
+		GMATH_TARGET_AVX2 void normalize_avx2(const vector<float, N>* src, vector<float, N>* dst, size_t count, int32_t steps)
+		{
+			for (size_t i = 0; i < count; i += 8)
+			{
+				size_t n = std::min<size_t>(8, count - i);
+				alignas(32) float scale[8]{};
+				for (size_t l = 0; l < n; l++)
+					scale[l] = src[i + l].sqr_magnitude();
+				__m256 sqr = _mm256_load_ps(scale);
+				_mm256_store_ps(scale, _mm256_and_ps(_mm256_cmp_ps(sqr, _mm256_setzero_ps(), _CMP_GT_OQ), rsqrt_avx2(sqr, steps)));
+				for (size_t l = 0; l < n; l++)
+				{
+					for (size_t d = 0; d < N; d++)
+						dst[i + l][d] = src[i + l][d] * scale[l];
+				}
+			}
+		}
+
+		/*
+		* AVX-512 F and BW
+		*/
+
+		GMATH_TARGET_AVX512 inline void transform_avx512(const mat4& m, const vec4* src, vec4* dst, size_t count)
+		{
+			__m512 r0 = _mm512_broadcast_f32x4(_mm_loadu_ps(m.elements));
+			__m512 r1 = _mm512_broadcast_f32x4(_mm_loadu_ps(m.elements + 4));
+			__m512 r2 = _mm512_broadcast_f32x4(_mm_loadu_ps(m.elements + 8));
+			__m512 r3 = _mm512_broadcast_f32x4(_mm_loadu_ps(m.elements + 12));
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m512 v = _mm512_loadu_ps(src[i].data);
+				__m512 r = _mm512_mul_ps(_mm512_permute_ps(v, 0x00), r0);
+				r = _mm512_fmadd_ps(_mm512_permute_ps(v, 0x55), r1, r);
+				r = _mm512_fmadd_ps(_mm512_permute_ps(v, 0xAA), r2, r);
+				r = _mm512_fmadd_ps(_mm512_permute_ps(v, 0xFF), r3, r);
+				_mm512_storeu_ps(dst[i].data, r);
+			}
+			transform_avx2(m, src + i, dst + i, count - i);
+		}
+
+		GMATH_TARGET_AVX512 inline void color_add_avx512(const color* src, const color& c, color* dst, size_t count)
+		{
+			__m512i cv = _mm512_set1_epi32(static_cast<int>(color_bits(c)));
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+				_mm512_storeu_si512(dst + i, _mm512_adds_epu8(_mm512_loadu_si512(src + i), cv));
+			color_add_avx2(src + i, c, dst + i, count - i);
+		}
+
+		GMATH_TARGET_AVX512 inline void color_subtract_avx512(const color* src, const color& c, color* dst, size_t count)
+		{
+			__m512i cv = _mm512_set1_epi32(static_cast<int>(color_bits(c)));
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+				_mm512_storeu_si512(dst + i, _mm512_subs_epu8(_mm512_loadu_si512(src + i), cv));
+			color_subtract_avx2(src + i, c, dst + i, count - i);
+		}
+
+		GMATH_TARGET_AVX512 inline void color_multiply_avx512(const color* src, const color& c, color* dst, size_t count)
+		{
+			const __m512i zero = _mm512_setzero_si512();
+			const __m512i max = _mm512_set1_epi16(255);
+			__m512i cw = _mm512_unpacklo_epi8(_mm512_set1_epi32(static_cast<int>(color_bits(c))), zero);
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+			{
+				__m512i v = _mm512_loadu_si512(src + i);
+				__m512i lo = _mm512_min_epu16(_mm512_mullo_epi16(_mm512_unpacklo_epi8(v, zero), cw), max);
+				__m512i hi = _mm512_min_epu16(_mm512_mullo_epi16(_mm512_unpackhi_epi8(v, zero), cw), max);
+				_mm512_storeu_si512(dst + i, _mm512_packus_epi16(lo, hi));
+			}
+			color_multiply_avx2(src + i, c, dst + i, count - i);
+		}
+
+		GMATH_TARGET_AVX512 inline void color_grayscale_avx512(const color* src, color* dst, size_t count)
+		{
+			const __m512i mask = _mm512_set1_epi32(0xFF);
+			const __m512i alpha = _mm512_set1_epi32(static_cast<int>(0xFF000000u));
+			const __m512i third = _mm512_set1_epi32(0xAAAB);
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+			{
+				__m512i v = _mm512_loadu_si512(src + i);
+				__m512i sum = _mm512_add_epi32(_mm512_add_epi32(_mm512_and_si512(v, mask), _mm512_and_si512(_mm512_srli_epi32(v, 8), mask)), _mm512_and_si512(_mm512_srli_epi32(v, 16), mask));
+				__m512i avg = _mm512_srli_epi32(_mm512_mulhi_epu16(sum, third), 1);
+				__m512i gray = _mm512_or_si512(_mm512_or_si512(avg, _mm512_slli_epi32(avg, 8)), _mm512_slli_epi32(avg, 16));
+				_mm512_storeu_si512(dst + i, _mm512_or_si512(gray, _mm512_and_si512(v, alpha)));
+			}
+			color_grayscale_avx2(src + i, dst + i, count - i);
+		}
+
+		template<bool Cosine>
+		GMATH_TARGET_AVX512 void sincos_avx512(const float* src, float* dst, size_t count)
+		{
+			const __m512 inv_pi = _mm512_set1_ps(static_cast<float>(INVERSED_PI));
+			const __m512 half = _mm512_set1_ps(0.5f);
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+			{
+				__m512 x = _mm512_loadu_ps(src + i);
+				__m512 k = _mm512_mul_ps(x, inv_pi);
+				if (Cosine)
+					k = _mm512_sub_ps(k, half);
+				__m512i ki = _mm512_cvtps_epi32(k);
+				k = _mm512_cvtepi32_ps(ki);
+				if (Cosine)
+				{
+					k = _mm512_add_ps(k, half);
+					ki = _mm512_add_epi32(ki, _mm512_set1_epi32(1));
+				}
+
+				__m512 r = _mm512_fnmadd_ps(k, _mm512_set1_ps(sincos_pi_a), x);
+				r = _mm512_fnmadd_ps(k, _mm512_set1_ps(sincos_pi_b), r);
+				r = _mm512_fnmadd_ps(k, _mm512_set1_ps(sincos_pi_c), r);
+				__m512 r2 = _mm512_mul_ps(r, r);
+
+				__m512 p = _mm512_fmadd_ps(r2, _mm512_set1_ps(-1.0f / 39916800.0f), _mm512_set1_ps(1.0f / 362880.0f));
+				p = _mm512_fmadd_ps(r2, p, _mm512_set1_ps(-1.0f / 5040.0f));
+				p = _mm512_fmadd_ps(r2, p, _mm512_set1_ps(1.0f / 120.0f));
+				p = _mm512_fmadd_ps(r2, p, _mm512_set1_ps(-1.0f / 6.0f));
+				p = _mm512_fmadd_ps(r2, p, _mm512_set1_ps(1.0f));
+
+				// AVX-512F has no float xor, the sign is flipped on the integer bits
+				__m512i bits = _mm512_xor_si512(_mm512_castps_si512(_mm512_mul_ps(r, p)), _mm512_slli_epi32(ki, 31));
+				_mm512_storeu_ps(dst + i, _mm512_castsi512_ps(bits));
+			}
+			sincos_avx2<Cosine>(src + i, dst + i, count - i);
+		}
+
+		// The 14 bit estimate of AVX-512 reaches full float precision in one step
+		GMATH_TARGET_AVX512 inline __m512 rsqrt_avx512(__m512 x, int32_t steps)
+		{
+			__m512 exact = _mm512_div_ps(_mm512_set1_ps(1.0f), _mm512_sqrt_ps(x));
+			if (steps < 0)
+				return exact;
+			__m512 y = _mm512_rsqrt14_ps(x);
+			__m512 half_x = _mm512_mul_ps(x, _mm512_set1_ps(0.5f));
+			for (int32_t s = 0; s < steps; s++)
+				y = _mm512_mul_ps(y, _mm512_fnmadd_ps(half_x, _mm512_mul_ps(y, y), _mm512_set1_ps(1.5f)));
+			__mmask16 normal = _mm512_cmp_ps_mask(x, _mm512_set1_ps(std::numeric_limits<float>::min()), _CMP_GE_OQ);
+			return _mm512_mask_blend_ps(normal, exact, y);
+		}
+
+		GMATH_TARGET_AVX512 inline void sqrt_avx512(const float* src, float* dst, size_t count, int32_t steps)
+		{
+			const __m512 smallest = _mm512_set1_ps(std::numeric_limits<float>::min());
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+			{
+				__m512 x = _mm512_loadu_ps(src + i);
+				__m512 r = steps < 0 ? _mm512_sqrt_ps(x) : _mm512_maskz_mul_ps(_mm512_cmp_ps_mask(x, smallest, _CMP_GE_OQ), x, rsqrt_avx512(x, steps));
+				_mm512_storeu_ps(dst + i, r);
+			}
+			if (i < count)
+			{
+				alignas(64) float tail[16]{};
+				std::copy(src + i, src + count, tail);
+				sqrt_avx512(tail, tail, 16, steps);
+				std::copy(tail, tail + (count - i), dst + i);
+			}
+		}
+
+		GMATH_TARGET_AVX512 inline void rsqrt_avx512(const float* src, float* dst, size_t count, int32_t steps)
+		{
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+				_mm512_storeu_ps(dst + i, rsqrt_avx512(_mm512_loadu_ps(src + i), steps));
+			if (i < count)
+			{
+				alignas(64) float tail[16]{};
+				std::copy(src + i, src + count, tail);
+				rsqrt_avx512(tail, tail, 16, steps);
+				std::copy(tail, tail + (count - i), dst + i);
+			}
+		}
+
+		template<size_t N>
+		GMATH_TARGET_AVX512 void normalize_avx512(const vector<float, N>* src, vector<float, N>* dst, size_t count, int32_t steps)
+		{
+			for (size_t i = 0; i < count; i += 16)
+			{
+				size_t n = std::min<size_t>(16, count - i);
+				alignas(64) float scale[16]{};
+				for (size_t l = 0; l < n; l++)
+					scale[l] = src[i + l].sqr_magnitude();
+				__m512 sqr = _mm512_load_ps(scale);
+				_mm512_store_ps(scale, _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(sqr, _mm512_setzero_ps(), _CMP_GT_OQ), rsqrt_avx512(sqr, steps)));
+				for (size_t l = 0; l < n; l++)
+				{
+					for (size_t d = 0; d < N; d++)
+						dst[i + l][d] = src[i + l][d] * scale[l];
+				}
+			}
+		}
+
+		struct kernel_table
+		{
+			simd_tier tier;
+			void (*transform)(const mat4&, const vec4*, vec4*, size_t);
+			void (*transform_points)(const mat4&, const vec3*, vec3*, size_t);
+			void (*color_add)(const color*, const color&, color*, size_t);
+			void (*color_subtract)(const color*, const color&, color*, size_t);
+			void (*color_multiply)(const color*, const color&, color*, size_t);
+			void (*color_grayscale)(const color*, color*, size_t);
+			void (*sin)(const float*, float*, size_t);
+			void (*cos)(const float*, float*, size_t);
+			void (*sqrt)(const float*, float*, size_t, int32_t);
+			void (*rsqrt)(const float*, float*, size_t, int32_t);
+			void (*normalize3)(const vec3*, vec3*, size_t, int32_t);
+			void (*normalize4)(const vec4*, vec4*, size_t, int32_t);
+		};
+
+		// Newton-Raphson steps the sqrt kernels take for a precision policy, negative means exact
+		template<typename P>
+		constexpr int32_t newton_steps()
+		{
+			if constexpr (std::is_same_v<P, precision_exact>)
+				return -1;
+			else if constexpr (std::is_same_v<P, precision_balanced>)
+				return 1;
+			else
+				return 0;
+		}
+
+		// Picks the implementation of the highest tier up to tier, nullptr marks a tier without its own implementation
+		template<typename F>
+		void bind_kernel(F& slot, simd_tier tier, std::initializer_list<std::type_identity_t<F>> implementations)
+		{
+			uint32_t level = 0;
+			for (F implementation : implementations)
+			{
+				if (level++ > static_cast<uint32_t>(tier))
+					break;
+				if (implementation)
+					slot = implementation;
+			}
+		}
+
+		inline kernel_table make_kernel_table(simd_tier tier)
+		{
+			kernel_table table{};
+			table.tier = tier;
+			bind_kernel(table.transform, tier, { transform_scalar, transform_sse2, nullptr, transform_avx2, transform_avx512 });
+			bind_kernel(table.transform_points, tier, { transform_points_scalar, transform_points_sse2, nullptr, transform_points_avx2, nullptr });
+			bind_kernel(table.color_add, tier, { color_add_scalar, color_add_sse2, nullptr, color_add_avx2, color_add_avx512 });
+			bind_kernel(table.color_subtract, tier, { color_subtract_scalar, color_subtract_sse2, nullptr, color_subtract_avx2, color_subtract_avx512 });
+			bind_kernel(table.color_multiply, tier, { color_multiply_scalar, color_multiply_sse2, color_multiply_sse41, color_multiply_avx2, color_multiply_avx512 });
+			bind_kernel(table.color_grayscale, tier, { color_grayscale_scalar, color_grayscale_sse2, nullptr, color_grayscale_avx2, color_grayscale_avx512 });
+			bind_kernel(table.sin, tier, { sincos_scalar<false>, sincos_sse2<false>, nullptr, sincos_avx2<false>, sincos_avx512<false> });
+			bind_kernel(table.cos, tier, { sincos_scalar<true>, sincos_sse2<true>, nullptr, sincos_avx2<true>, sincos_avx512<true> });
+			bind_kernel(table.sqrt, tier, { sqrt_scalar, sqrt_sse2, nullptr, sqrt_avx2, sqrt_avx512 });
+			bind_kernel(table.rsqrt, tier, { rsqrt_scalar, rsqrt_sse2, nullptr, rsqrt_avx2, rsqrt_avx512 });
+			bind_kernel(table.normalize3, tier, { normalize_scalar<3>, normalize_sse2<3>, nullptr, normalize_avx2<3>, normalize_avx512<3> });
+			bind_kernel(table.normalize4, tier, { normalize_scalar<4>, normalize_sse2<4>, nullptr, normalize_avx2<4>, normalize_avx512<4> });
+			return table;
+		}
+	}
+
+	// Bound on first use to active_simd_tier()
+	inline const detail::kernel_table& kernels()
+	{
+		static const detail::kernel_table table = detail::make_kernel_table(active_simd_tier());
+		return table;
+	}
+
+	// dst[i] = src[i] * m with src[i] as a row vector
+	inline void transform(const mat4& m, const vec4* src, vec4* dst, size_t count)
+	{
+		auto kernel = kernels().transform;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(m, src + first, dst + first, last - first); });
+	}
+
+	// Points with w = 1, without a perspective divide
+	inline void transform_points(const mat4& m, const vec3* src, vec3* dst, size_t count)
+	{
+		auto kernel = kernels().transform_points;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(m, src + first, dst + first, last - first); });
+	}
+
+	// Saturating per channel like color's operators
+	inline void color_add(const color* src, const color& c, color* dst, size_t count)
+	{
+		auto kernel = kernels().color_add;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(src + first, c, dst + first, last - first); });
+	}
+
+	inline void color_subtract(const color* src, const color& c, color* dst, size_t count)
+	{
+		auto kernel = kernels().color_subtract;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(src + first, c, dst + first, last - first); });
+	}
+
+	inline void color_multiply(const color* src, const color& c, color* dst, size_t count)
+	{
+		auto kernel = kernels().color_multiply;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(src + first, c, dst + first, last - first); });
+	}
+
+	inline void color_grayscale(const color* src, color* dst, size_t count)
+	{
+		auto kernel = kernels().color_grayscale;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(src + first, dst + first, last - first); });
+	}
+
+	inline void sin(const float* src, float* dst, size_t count)
+	{
+		auto kernel = kernels().sin;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(src + first, dst + first, last - first); });
+	}
+
+	inline void cos(const float* src, float* dst, size_t count)
+	{
+		auto kernel = kernels().cos;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(src + first, dst + first, last - first); });
+	}
+
+	/*
+	* Batched sqrt, rsqrt and normalize. The precision policy picks the number of Newton-Raphson steps on the hardware
+	* estimate: none for precision_fast, one for precision_balanced, and precision_exact uses the correctly rounded
+	* instructions. None of them change the floating point control register.
+	*/
+
+	template<typename P = default_precision_t<float>>
+	void sqrt(const float* src, float* dst, size_t count)
+	{
+		auto kernel = kernels().sqrt;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(src + first, dst + first, last - first, detail::newton_steps<P>()); });
+	}
+
+	template<typename P = default_precision_t<float>>
+	void rsqrt(const float* src, float* dst, size_t count)
+	{
+		auto kernel = kernels().rsqrt;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(src + first, dst + first, last - first, detail::newton_steps<P>()); });
+	}
+
+	// Zero length vectors stay zero like vector::normalize
+	template<typename P = default_precision_t<float>>
+	void normalize(const vec3* src, vec3* dst, size_t count)
+	{
+		auto kernel = kernels().normalize3;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(src + first, dst + first, last - first, detail::newton_steps<P>()); });
+	}
+
+	template<typename P = default_precision_t<float>>
+	void normalize(const vec4* src, vec4* dst, size_t count)
+	{
+		auto kernel = kernels().normalize4;
+		parallel_batch(count, [&](size_t first, size_t last) { kernel(src + first, dst + first, last - first, detail::newton_steps<P>()); });
+	}
+}
\ No newline at end of file
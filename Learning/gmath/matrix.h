@@ -4,6 +4,7 @@
 #include <sstream>
 #include <string>
 #include <format>
+#include <iterator>
 
 #include "vec.h"
 #include "gmath.h"
@@ -90,13 +91,20 @@ namespace gmath
 		std::string to_string() const
 		{
 			std::stringstream ss;
-			ss << this;
+			ss << *this;
 			return ss.str();
 		}
 
 		matrix<T, M, N> transpose() const
 		{
 			matrix<T, M, N> result{};
+#ifdef GMATH_AVX
+			if constexpr (std::is_same_v<T, double> && N == 4 && M == 4)
+			{
+				detail::transpose4x4d(elements, result.elements);
+				return result;
+			}
+#endif
 			for (size_t i = 0; i < N; i++)
 			{
 				for (size_t j = 0; j < M; j++)
@@ -150,12 +158,13 @@ namespace gmath
 			return result;
 		}
 
+		template<typename P = default_precision_t<T>>
 		static matrix<T, 4, 4> rotation(const T& angle, const vec<T, 3>& axis)
 		{
 			matrix<T, 4, 4> result{ 1.0 };
 			T r = deg_to_rad(angle);
-			T c = gmath::cos(r);
-			T s = gmath::sin(r);
+			T c = gmath::cos<T, P>(r);
+			T s = gmath::sin<T, P>(r);
 			T omc = 1.0 - c;
 			result.elements[0 + 0 * 4] = axis.x * omc + c;
 			result.elements[1 + 0 * 4] = axis.y * axis.x * omc + axis.z * s;
@@ -179,7 +188,16 @@ namespace gmath
 
 		static matrix<T, 4, 4> inverse(matrix<T, 4, 4>& mat)
 		{
+			GMATH_PROFILE_SCOPE(matrix_inverse);
+
 			matrix<T, 4, 4> result{};
+#ifdef GMATH_AVX
+			if constexpr (std::is_same_v<T, double>)
+			{
+				detail::inverse4x4d(mat.elements, result.elements);
+				return result;
+			}
+#endif
 
 			result.elements[0] = mat.elements[5] * mat.elements[10] * mat.elements[15] -
 				mat.elements[5] * mat.elements[11] * mat.elements[14] -
@@ -305,7 +323,16 @@ namespace gmath
 	auto operator*(const matrix<T, N, M>& a, const matrix<U, M, N>& b)
 		-> matrix<decltype(a[0] * b[0]), N, N>
 	{
+		GMATH_PROFILE_SCOPE(matrix_multiply);
+
 		matrix<decltype(a[0] * b[0]), N, N> result{};
+#ifdef GMATH_AVX
+		if constexpr (std::is_same_v<T, double> && std::is_same_v<U, double> && N == 4 && M == 4)
+		{
+			detail::multiply4x4d(a.elements, b.elements, result.elements);
+			return result;
+		}
+#endif
 		for (size_t i = 0; i < N; i++)
 		{
 			for (size_t j = 0; j < N; j++)
@@ -321,6 +348,38 @@ namespace gmath
 		return result;
 	}
 
+	// Row vector times matrix, the translation of a transform sits in the last row
+	template<typename T>
+	vector<T, 4> transform(const matrix<T, 4, 4>& m, const vector<T, 4>& v)
+	{
+		vector<T, 4> result{};
+#ifdef GMATH_AVX
+		if constexpr (std::is_same_v<T, double>)
+		{
+			detail::transform4d(m.elements, v.data, result.data);
+			return result;
+		}
+#endif
+		for (size_t j = 0; j < 4; j++)
+		{
+			T sum{};
+			for (size_t i = 0; i < 4; i++)
+			{
+				sum += v[i] * m.rows[i][j];
+			}
+			result[j] = sum;
+		}
+		return result;
+	}
+
+	// Transforms a point with w = 1, without a perspective divide
+	template<typename T>
+	vector<T, 3> transform_point(const matrix<T, 4, 4>& m, const vector<T, 3>& p)
+	{
+		vector<T, 4> result = transform(m, vector<T, 4>{ p.x, p.y, p.z, T(1) });
+		return { result.x, result.y, result.z };
+	}
+
 	template<typename T, typename U, size_t N, size_t M>
 	auto operator*=(matrix<T, N, M>& a, const U& b)
 		-> matrix<decltype(a[0] * b), N, M>&
@@ -385,7 +444,7 @@ namespace gmath
 			stream << "(";
 			for (size_t j = 0; j < M; j++)
 			{
-				stream << std::format("{:3}", mat.rows[i][j]);
+				std::format_to(std::ostreambuf_iterator<char>(stream), "{:3}", mat.rows[i][j]);
 				if (j + 1 < M)
 					stream << ", ";
 			}
@@ -0,0 +1,559 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+
+#include "gmath.h"
+#include "vec.h"
+#include "color.h"
+#include "image.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace gmath
+{
+	/*
+	* Seeded value, Perlin and simplex noise with fBm over vec2 and vec3 inputs.
+	* Every generator is written once over simd<float, W>. Single samples run it with one lane, spans and grids with
+	* the widest register the compiler targets, so both give the same values up to float rounding of the lane order.
+	* Results are roughly in [-1, 1] and the lattice repeats every 256 units. A noise object is immutable after construction
+	* and can be shared between threads.
+	*/
+
+	enum class noise_type
+	{
+		value,
+		perlin,
+		simplex
+	};
+
+	struct fbm_params
+	{
+		size_t octaves{ 1 };
+		float frequency{ 1.0f };
+		// Frequency multiplier and amplitude multiplier between octaves
+		float lacunarity{ 2.0f };
+		float gain{ 0.5f };
+	};
+
+	class noise
+	{
+	public:
+		explicit noise(uint32_t seed = 0)
+		{
+			// Fisher-Yates on mt19937 output, std::shuffle is not specified exactly and would give other fields per standard library
+			std::mt19937 generator(seed);
+			for (uint32_t i = 0; i < 256; i++)
+				perm[i] = static_cast<uint8_t>(i);
+			for (uint32_t i = 255; i > 0; i--)
+				std::swap(perm[i], perm[generator() % (i + 1)]);
+			std::copy(perm, perm + 256, perm + 256);
+		}
+
+		float sample(const noise_type type, const vec2& p, const fbm_params& fbm = {}) const
+		{
+			return evaluate<1>(type, p.x, p.y, fbm)[0];
+		}
+
+		float sample(const noise_type type, const vec3& p, const fbm_params& fbm = {}) const
+		{
+			return evaluate<1>(type, p.x, p.y, p.z, fbm)[0];
+		}
+
+		float value(const vec2& p) const { return value2<1>(p.x, p.y)[0]; }
+		float value(const vec3& p) const { return value3<1>(p.x, p.y, p.z)[0]; }
+		float perlin(const vec2& p) const { return perlin2<1>(p.x, p.y)[0]; }
+		float perlin(const vec3& p) const { return perlin3<1>(p.x, p.y, p.z)[0]; }
+		float simplex(const vec2& p) const { return simplex2<1>(p.x, p.y)[0]; }
+		float simplex(const vec3& p) const { return simplex3<1>(p.x, p.y, p.z)[0]; }
+
+		/*
+		* Batch
+		*/
+
+		void sample(const noise_type type, const vec2* points, float* out, size_t count, const fbm_params& fbm = {}) const
+		{
+			parallel_batch(count, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i += lanes)
+				{
+					size_t n = std::min(lanes, last - i);
+					float x[lanes]{}, y[lanes]{}, r[lanes];
+					for (size_t l = 0; l < n; l++)
+					{
+						x[l] = points[i + l].x;
+						y[l] = points[i + l].y;
+					}
+					evaluate<lanes>(type, lane_type::load(x), lane_type::load(y), fbm).store(r);
+					std::copy(r, r + n, out + i);
+				}
+			});
+		}
+
+		void sample(const noise_type type, const vec3* points, float* out, size_t count, const fbm_params& fbm = {}) const
+		{
+			parallel_batch(count, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i += lanes)
+				{
+					size_t n = std::min(lanes, last - i);
+					float x[lanes]{}, y[lanes]{}, z[lanes]{}, r[lanes];
+					for (size_t l = 0; l < n; l++)
+					{
+						x[l] = points[i + l].x;
+						y[l] = points[i + l].y;
+						z[l] = points[i + l].z;
+					}
+					evaluate<lanes>(type, lane_type::load(x), lane_type::load(y), lane_type::load(z), fbm).store(r);
+					std::copy(r, r + n, out + i);
+				}
+			});
+		}
+
+		// Pixel (x, y) of the plane gets the noise at origin + (x, y) * step, rows are generated in parallel
+		void fill(const noise_type type, const image_view<float>& plane, const vec2& origin, const vec2& step, const fbm_params& fbm = {}) const
+		{
+			generate(type, plane.width, plane.height, vec3(origin.x, origin.y, 0.0f), step, false, fbm,
+				[&plane](size_t x, size_t y, const float* values, size_t n) { std::copy(values, values + n, plane.row(y) + x); });
+		}
+
+		// Slice of 3D noise at z = origin.z, animating origin.z scrolls through the volume
+		void fill(const noise_type type, const image_view<float>& plane, const vec3& origin, const vec2& step, const fbm_params& fbm = {}) const
+		{
+			generate(type, plane.width, plane.height, origin, step, true, fbm,
+				[&plane](size_t x, size_t y, const float* values, size_t n) { std::copy(values, values + n, plane.row(y) + x); });
+		}
+
+		// Maps -1 to low and 1 to high
+		template<typename T>
+		void fill(const noise_type type, const image_view<color_base<T>>& target, const vec2& origin, const vec2& step, const color_base<T>& low, const color_base<T>& high, const fbm_params& fbm = {}) const
+		{
+			generate(type, target.width, target.height, vec3(origin.x, origin.y, 0.0f), step, false, fbm,
+				[&](size_t x, size_t y, const float* values, size_t n) { shade(values, target.row(y) + x, n, low, high); });
+		}
+
+		template<typename T>
+		void fill(const noise_type type, const image_view<color_base<T>>& target, const vec3& origin, const vec2& step, const color_base<T>& low, const color_base<T>& high, const fbm_params& fbm = {}) const
+		{
+			generate(type, target.width, target.height, origin, step, true, fbm,
+				[&](size_t x, size_t y, const float* values, size_t n) { shade(values, target.row(y) + x, n, low, high); });
+		}
+
+	private:
+		static constexpr size_t lanes = simd_native_width<float>();
+		using lane_type = simd<float, lanes>;
+
+		// Shifts every octave away from the previous one, so the lattice points of the octaves do not line up at the origin
+		static constexpr float octave_offset = 17.31f;
+
+		static constexpr float gradients2[8][2] =
+		{
+			{ 1.0f, 1.0f }, { -1.0f, 1.0f }, { 1.0f, -1.0f }, { -1.0f, -1.0f },
+			{ 1.0f, 0.0f }, { -1.0f, 0.0f }, { 0.0f, 1.0f }, { 0.0f, -1.0f }
+		};
+
+		// The 12 cube edges of improved Perlin noise, padded to 16 so a hash can be masked instead of taken modulo 12
+		static constexpr float gradients3[16][3] =
+		{
+			{ 1.0f, 1.0f, 0.0f }, { -1.0f, 1.0f, 0.0f }, { 1.0f, -1.0f, 0.0f }, { -1.0f, -1.0f, 0.0f },
+			{ 1.0f, 0.0f, 1.0f }, { -1.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, -1.0f }, { -1.0f, 0.0f, -1.0f },
+			{ 0.0f, 1.0f, 1.0f }, { 0.0f, -1.0f, 1.0f }, { 0.0f, 1.0f, -1.0f }, { 0.0f, -1.0f, -1.0f },
+			{ 1.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 1.0f }, { -1.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, -1.0f }
+		};
+
+		uint8_t perm[512];
+
+		int32_t hash(int32_t x, int32_t y) const
+		{
+			return perm[perm[x & 255] + (y & 255)];
+		}
+
+		int32_t hash(int32_t x, int32_t y, int32_t z) const
+		{
+			return perm[perm[perm[x & 255] + (y & 255)] + (z & 255)];
+		}
+
+		// Integer lattice coordinates of floored lanes, the table lookups are the only part that runs per lane
+		template<size_t W>
+		static void lattice(const simd<float, W>& floored, int32_t* out)
+		{
+			float values[W];
+			floored.store(values);
+			for (size_t l = 0; l < W; l++)
+				out[l] = static_cast<int32_t>(values[l]);
+		}
+
+		template<size_t W>
+		static simd<float, W> fade(const simd<float, W>& t)
+		{
+			using V = simd<float, W>;
+			return t * t * t * fma(t, fma(t, V(6.0f), V(-15.0f)), V(10.0f));
+		}
+
+		template<size_t W>
+		static simd<float, W> mix(const simd<float, W>& a, const simd<float, W>& b, const simd<float, W>& t)
+		{
+			return fma(b - a, t, a);
+		}
+
+		template<size_t W>
+		simd<float, W> value2(const simd<float, W>& x, const simd<float, W>& y) const
+		{
+			using V = simd<float, W>;
+			V x0 = floor(x), y0 = floor(y);
+			int32_t xi[W], yi[W];
+			lattice(x0, xi);
+			lattice(y0, yi);
+
+			float corners[4][W];
+			for (size_t l = 0; l < W; l++)
+			{
+				for (int32_t c = 0; c < 4; c++)
+					corners[c][l] = hash(xi[l] + (c & 1), yi[l] + (c >> 1)) * (2.0f / 255.0f) - 1.0f;
+			}
+
+			V u = fade(x - x0), v = fade(y - y0);
+			V bottom = mix(V::load(corners[0]), V::load(corners[1]), u);
+			V top = mix(V::load(corners[2]), V::load(corners[3]), u);
+			return mix(bottom, top, v);
+		}
+
+		template<size_t W>
+		simd<float, W> value3(const simd<float, W>& x, const simd<float, W>& y, const simd<float, W>& z) const
+		{
+			using V = simd<float, W>;
+			V x0 = floor(x), y0 = floor(y), z0 = floor(z);
+			int32_t xi[W], yi[W], zi[W];
+			lattice(x0, xi);
+			lattice(y0, yi);
+			lattice(z0, zi);
+
+			float corners[8][W];
+			for (size_t l = 0; l < W; l++)
+			{
+				for (int32_t c = 0; c < 8; c++)
+					corners[c][l] = hash(xi[l] + (c & 1), yi[l] + ((c >> 1) & 1), zi[l] + (c >> 2)) * (2.0f / 255.0f) - 1.0f;
+			}
+
+			V u = fade(x - x0), v = fade(y - y0), w = fade(z - z0);
+			V c00 = mix(V::load(corners[0]), V::load(corners[1]), u);
+			V c10 = mix(V::load(corners[2]), V::load(corners[3]), u);
+			V c01 = mix(V::load(corners[4]), V::load(corners[5]), u);
+			V c11 = mix(V::load(corners[6]), V::load(corners[7]), u);
+			return mix(mix(c00, c10, v), mix(c01, c11, v), w);
+		}
+
+		template<size_t W>
+		simd<float, W> perlin2(const simd<float, W>& x, const simd<float, W>& y) const
+		{
+			using V = simd<float, W>;
+			V x0 = floor(x), y0 = floor(y);
+			int32_t xi[W], yi[W];
+			lattice(x0, xi);
+			lattice(y0, yi);
+
+			float g[4][2][W];
+			for (size_t l = 0; l < W; l++)
+			{
+				for (int32_t c = 0; c < 4; c++)
+				{
+					const float* gradient = gradients2[hash(xi[l] + (c & 1), yi[l] + (c >> 1)) & 7];
+					g[c][0][l] = gradient[0];
+					g[c][1][l] = gradient[1];
+				}
+			}
+
+			V fx = x - x0, fy = y - y0;
+			V one(1.0f);
+			V n00 = fma(V::load(g[0][0]), fx, V::load(g[0][1]) * fy);
+			V n10 = fma(V::load(g[1][0]), fx - one, V::load(g[1][1]) * fy);
+			V n01 = fma(V::load(g[2][0]), fx, V::load(g[2][1]) * (fy - one));
+			V n11 = fma(V::load(g[3][0]), fx - one, V::load(g[3][1]) * (fy - one));
+
+			V u = fade(fx), v = fade(fy);
+			return mix(mix(n00, n10, u), mix(n01, n11, u), v);
+		}
+
+		template<size_t W>
+		simd<float, W> perlin3(const simd<float, W>& x, const simd<float, W>& y, const simd<float, W>& z) const
+		{
+			using V = simd<float, W>;
+			V x0 = floor(x), y0 = floor(y), z0 = floor(z);
+			int32_t xi[W], yi[W], zi[W];
+			lattice(x0, xi);
+			lattice(y0, yi);
+			lattice(z0, zi);
+
+			float g[8][3][W];
+			for (size_t l = 0; l < W; l++)
+			{
+				for (int32_t c = 0; c < 8; c++)
+				{
+					const float* gradient = gradients3[hash(xi[l] + (c & 1), yi[l] + ((c >> 1) & 1), zi[l] + (c >> 2)) & 15];
+					g[c][0][l] = gradient[0];
+					g[c][1][l] = gradient[1];
+					g[c][2][l] = gradient[2];
+				}
+			}
+
+			V fx = x - x0, fy = y - y0, fz = z - z0;
+			V one(1.0f);
+			V n[8];
+			for (int32_t c = 0; c < 8; c++)
+			{
+				V dx = c & 1 ? fx - one : fx;
+				V dy = c & 2 ? fy - one : fy;
+				V dz = c & 4 ? fz - one : fz;
+				n[c] = fma(V::load(g[c][0]), dx, fma(V::load(g[c][1]), dy, V::load(g[c][2]) * dz));
+			}
+
+			V u = fade(fx), v = fade(fy), w = fade(fz);
+			V c00 = mix(n[0], n[1], u);
+			V c10 = mix(n[2], n[3], u);
+			V c01 = mix(n[4], n[5], u);
+			V c11 = mix(n[6], n[7], u);
+			return mix(mix(c00, c10, v), mix(c01, c11, v), w);
+		}
+
+		// Falloff (r^2 - d^2)^4 of a simplex corner times its gradient ramp, zero outside the radius
+		template<size_t W>
+		static simd<float, W> corner(const simd<float, W>& radius, const simd<float, W>& ramp, const simd<float, W>& d2)
+		{
+			simd<float, W> t = max(radius - d2, simd<float, W>(0.0f));
+			t = t * t;
+			return t * t * ramp;
+		}
+
+		template<size_t W>
+		simd<float, W> simplex2(const simd<float, W>& x, const simd<float, W>& y) const
+		{
+			using V = simd<float, W>;
+			const float f2 = 0.366025403784f; // (sqrt(3) - 1) / 2
+			const float g2 = 0.211324865405f; // (3 - sqrt(3)) / 6
+
+			// Skew to the square lattice and find the triangle the point is in
+			V s = (x + y) * V(f2);
+			V i = floor(x + s), j = floor(y + s);
+			V t = (i + j) * V(g2);
+			V x0 = x - (i - t), y0 = y - (j - t);
+			V i1 = select(x0 > y0, V(1.0f), V(0.0f));
+			V j1 = V(1.0f) - i1;
+
+			int32_t ii[W], jj[W];
+			lattice(i, ii);
+			lattice(j, jj);
+			float step[W];
+			i1.store(step);
+
+			float g[3][2][W];
+			for (size_t l = 0; l < W; l++)
+			{
+				int32_t a = static_cast<int32_t>(step[l]);
+				const float* corners[3] =
+				{
+					gradients2[hash(ii[l], jj[l]) & 7],
+					gradients2[hash(ii[l] + a, jj[l] + 1 - a) & 7],
+					gradients2[hash(ii[l] + 1, jj[l] + 1) & 7]
+				};
+				for (size_t c = 0; c < 3; c++)
+				{
+					g[c][0][l] = corners[c][0];
+					g[c][1][l] = corners[c][1];
+				}
+			}
+
+			V x1 = x0 - i1 + V(g2), y1 = y0 - j1 + V(g2);
+			V x2 = x0 + V(2.0f * g2 - 1.0f), y2 = y0 + V(2.0f * g2 - 1.0f);
+
+			V radius(0.5f);
+			V n = corner(radius, fma(V::load(g[0][0]), x0, V::load(g[0][1]) * y0), fma(x0, x0, y0 * y0));
+			n += corner(radius, fma(V::load(g[1][0]), x1, V::load(g[1][1]) * y1), fma(x1, x1, y1 * y1));
+			n += corner(radius, fma(V::load(g[2][0]), x2, V::load(g[2][1]) * y2), fma(x2, x2, y2 * y2));
+			return n * V(simplex2_scale);
+		}
+
+		template<size_t W>
+		simd<float, W> simplex3(const simd<float, W>& x, const simd<float, W>& y, const simd<float, W>& z) const
+		{
+			using V = simd<float, W>;
+			const float f3 = 1.0f / 3.0f;
+			const float g3 = 1.0f / 6.0f;
+
+			V s = (x + y + z) * V(f3);
+			V i = floor(x + s), j = floor(y + s), k = floor(z + s);
+			V t = (i + j + k) * V(g3);
+			V x0 = x - (i - t), y0 = y - (j - t), z0 = z - (k - t);
+
+			// The largest offset takes the first step, the two largest ones the second, ties go to the lower axis
+			V one(1.0f), zero(0.0f);
+			auto xy = x0 >= y0, xz = x0 >= z0, yz = y0 >= z0;
+			V i1 = select(xy & xz, one, zero);
+			V j1 = select((!xy) & yz, one, zero);
+			V k1 = select((!xz) & (!yz), one, zero);
+			V i2 = select(xy | xz, one, zero);
+			V j2 = select((!xy) | yz, one, zero);
+			V k2 = select((!xz) | (!yz), one, zero);
+
+			int32_t ii[W], jj[W], kk[W];
+			lattice(i, ii);
+			lattice(j, jj);
+			lattice(k, kk);
+			float steps[6][W];
+			i1.store(steps[0]);
+			j1.store(steps[1]);
+			k1.store(steps[2]);
+			i2.store(steps[3]);
+			j2.store(steps[4]);
+			k2.store(steps[5]);
+
+			float g[4][3][W];
+			for (size_t l = 0; l < W; l++)
+			{
+				int32_t a[6];
+				for (size_t c = 0; c < 6; c++)
+					a[c] = static_cast<int32_t>(steps[c][l]);
+				const float* corners[4] =
+				{
+					gradients3[hash(ii[l], jj[l], kk[l]) & 15],
+					gradients3[hash(ii[l] + a[0], jj[l] + a[1], kk[l] + a[2]) & 15],
+					gradients3[hash(ii[l] + a[3], jj[l] + a[4], kk[l] + a[5]) & 15],
+					gradients3[hash(ii[l] + 1, jj[l] + 1, kk[l] + 1) & 15]
+				};
+				for (size_t c = 0; c < 4; c++)
+				{
+					for (size_t e = 0; e < 3; e++)
+						g[c][e][l] = corners[c][e];
+				}
+			}
+
+			V offsets[4][3] =
+			{
+				{ x0, y0, z0 },
+				{ x0 - i1 + V(g3), y0 - j1 + V(g3), z0 - k1 + V(g3) },
+				{ x0 - i2 + V(2.0f * g3), y0 - j2 + V(2.0f * g3), z0 - k2 + V(2.0f * g3) },
+				{ x0 + V(3.0f * g3 - 1.0f), y0 + V(3.0f * g3 - 1.0f), z0 + V(3.0f * g3 - 1.0f) }
+			};
+
+			V radius(0.6f);
+			V n(0.0f);
+			for (size_t c = 0; c < 4; c++)
+			{
+				const V* d = offsets[c];
+				V ramp = fma(V::load(g[c][0]), d[0], fma(V::load(g[c][1]), d[1], V::load(g[c][2]) * d[2]));
+				n += corner(radius, ramp, fma(d[0], d[0], fma(d[1], d[1], d[2] * d[2])));
+			}
+			return n * V(simplex3_scale);
+		}
+
+		// Measured peaks of the unscaled sums, they map the extremes to about -1 and 1
+		static constexpr float simplex2_scale = 70.0f;
+		static constexpr float simplex3_scale = 32.0f;
+
+		template<size_t W>
+		simd<float, W> octave(const noise_type type, const simd<float, W>& x, const simd<float, W>& y) const
+		{
+			switch (type)
+			{
+			case noise_type::value:
+				return value2(x, y);
+			case noise_type::perlin:
+				return perlin2(x, y);
+			default:
+				return simplex2(x, y);
+			}
+		}
+
+		template<size_t W>
+		simd<float, W> octave(const noise_type type, const simd<float, W>& x, const simd<float, W>& y, const simd<float, W>& z) const
+		{
+			switch (type)
+			{
+			case noise_type::value:
+				return value3(x, y, z);
+			case noise_type::perlin:
+				return perlin3(x, y, z);
+			default:
+				return simplex3(x, y, z);
+			}
+		}
+
+		// fBm sums the octaves and divides by the total amplitude, so it keeps the range of a single octave
+		template<size_t W>
+		simd<float, W> evaluate(const noise_type type, const simd<float, W>& x, const simd<float, W>& y, const fbm_params& fbm) const
+		{
+			using V = simd<float, W>;
+			V sum(0.0f);
+			float frequency = fbm.frequency, amplitude = 1.0f, total = 0.0f;
+			for (size_t o = 0; o < std::max<size_t>(1, fbm.octaves); o++)
+			{
+				V offset(o * octave_offset);
+				sum = fma(octave(type, fma(x, V(frequency), offset), fma(y, V(frequency), offset)), V(amplitude), sum);
+				total += amplitude;
+				frequency *= fbm.lacunarity;
+				amplitude *= fbm.gain;
+			}
+			return sum * V(1.0f / total);
+		}
+
+		template<size_t W>
+		simd<float, W> evaluate(const noise_type type, const simd<float, W>& x, const simd<float, W>& y, const simd<float, W>& z, const fbm_params& fbm) const
+		{
+			using V = simd<float, W>;
+			V sum(0.0f);
+			float frequency = fbm.frequency, amplitude = 1.0f, total = 0.0f;
+			for (size_t o = 0; o < std::max<size_t>(1, fbm.octaves); o++)
+			{
+				V offset(o * octave_offset);
+				sum = fma(octave(type, fma(x, V(frequency), offset), fma(y, V(frequency), offset), fma(z, V(frequency), offset)), V(amplitude), sum);
+				total += amplitude;
+				frequency *= fbm.lacunarity;
+				amplitude *= fbm.gain;
+			}
+			return sum * V(1.0f / total);
+		}
+
+		// Evaluates a width x height grid a register at a time and hands every row segment to store(x, y, values, n)
+		template<typename Store>
+		void generate(const noise_type type, size_t width, size_t height, const vec3& origin, const vec2& step, bool volume, const fbm_params& fbm, Store store) const
+		{
+			float ramp[lanes];
+			for (size_t l = 0; l < lanes; l++)
+				ramp[l] = static_cast<float>(l);
+			lane_type offsets = lane_type::load(ramp);
+			size_t grain = std::max<size_t>(1, get_parallel_config().batch_grain / std::max<size_t>(1, width));
+
+			parallel_for(height, grain, [&](size_t first, size_t last)
+			{
+				float values[lanes];
+				for (size_t y = first; y < last; y++)
+				{
+					lane_type py(origin.y + y * step.y);
+					for (size_t x = 0; x < width; x += lanes)
+					{
+						lane_type px = fma(offsets + lane_type(static_cast<float>(x)), lane_type(step.x), lane_type(origin.x));
+						lane_type n = volume ? evaluate<lanes>(type, px, py, lane_type(origin.z), fbm) : evaluate<lanes>(type, px, py, fbm);
+						n.store(values);
+						store(x, y, values, std::min(lanes, width - x));
+					}
+				}
+			});
+		}
+
+		template<typename T>
+		static void shade(const float* values, color_base<T>* out, size_t n, const color_base<T>& low, const color_base<T>& high)
+		{
+			for (size_t i = 0; i < n; i++)
+			{
+				float t = std::clamp(values[i] * 0.5f + 0.5f, 0.0f, 1.0f);
+				for (size_t c = 0; c < 4; c++)
+				{
+					float channel = static_cast<float>(low[c]) + (static_cast<float>(high[c]) - static_cast<float>(low[c])) * t;
+					out[i][c] = static_cast<T>(std::is_integral_v<T> ? channel + 0.5f : channel);
+				}
+			}
+		}
+	};
+}
\ No newline at end of file
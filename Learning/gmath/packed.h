@@ -0,0 +1,296 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <emmintrin.h>
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define GMATH_F16C
+#include <immintrin.h>
+#endif
+
+#include "vec.h"
+#include "parallel.h"
+
+namespace gmath
+{
+	/*
+	* Compact scalar types for vertex and particle streams.
+	* They only store data and convert implicitly to and from float, so vector<half, 3> etc. work with the regular
+	* vector operators, which widen to float. Arrays are converted in bulk with convert().
+	*/
+
+	// IEEE 754 binary16, conversions round to nearest even
+	struct half
+	{
+		uint16_t bits;
+
+		half() = default;
+
+		half(const float& value)
+			: bits(from_float(value)) {}
+
+		operator float() const
+		{
+			return to_float(bits);
+		}
+
+		static half from_bits(const uint16_t bits)
+		{
+			half h;
+			h.bits = bits;
+			return h;
+		}
+
+		static uint16_t from_float(const float& value)
+		{
+#ifdef GMATH_F16C
+			return static_cast<uint16_t>(_mm_extract_epi16(_mm_cvtps_ph(_mm_set_ss(value), _MM_FROUND_TO_NEAREST_INT), 0));
+#else
+			const uint32_t f16_max = (127 + 16) << 23;
+			const uint32_t denorm_magic = ((127 - 15) + (23 - 10) + 1) << 23;
+
+			uint32_t f = std::bit_cast<uint32_t>(value);
+			uint32_t sign = f & 0x80000000u;
+			f ^= sign;
+
+			uint32_t h;
+			if (f >= f16_max)
+			{
+				h = f > 0x7F800000u ? 0x7E00 : 0x7C00;
+			}
+			else if (f < (113u << 23))
+			{
+				// Subnormal or zero, the float addition does the rounding
+				h = std::bit_cast<uint32_t>(std::bit_cast<float>(f) + std::bit_cast<float>(denorm_magic)) - denorm_magic;
+			}
+			else
+			{
+				uint32_t mantissa_odd = (f >> 13) & 1;
+				f += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF;
+				f += mantissa_odd;
+				h = f >> 13;
+			}
+			return static_cast<uint16_t>(h | (sign >> 16));
+#endif
+		}
+
+		static float to_float(const uint16_t bits)
+		{
+#ifdef GMATH_F16C
+			return _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(bits)));
+#else
+			const uint32_t shifted_exponent = 0x7C00u << 13;
+			const float magic = std::bit_cast<float>(113u << 23);
+
+			uint32_t f = (bits & 0x7FFFu) << 13;
+			uint32_t exponent = f & shifted_exponent;
+			f += (127 - 15) << 23;
+			if (exponent == shifted_exponent)
+			{
+				f += (128 - 16) << 23;
+			}
+			else if (exponent == 0)
+			{
+				f += 1 << 23;
+				f = std::bit_cast<uint32_t>(std::bit_cast<float>(f) - magic);
+			}
+			return std::bit_cast<float>(f | ((bits & 0x8000u) << 16));
+#endif
+		}
+	};
+
+	// Signed normalized integer, [-1, 1] maps to [-max, max]
+	template<typename I>
+	struct snorm
+	{
+		static_assert(std::is_signed_v<I> && std::is_integral_v<I>, "snorm needs a signed integer type");
+
+		I bits;
+
+		snorm() = default;
+
+		snorm(const float& value)
+			: bits(static_cast<I>(std::lrint(gmath::clamp(value, -1.0f, 1.0f) * std::numeric_limits<I>::max()))) {}
+
+		// Multiplies by the reciprocal like the batch conversions, so a value decodes the same in the body and the tail
+		operator float() const
+		{
+			return gmath::max(static_cast<float>(bits) * (1.0f / std::numeric_limits<I>::max()), -1.0f);
+		}
+	};
+
+	// Unsigned normalized integer, [0, 1] maps to [0, max]
+	template<typename I>
+	struct unorm
+	{
+		static_assert(std::is_unsigned_v<I> && std::is_integral_v<I>, "unorm needs an unsigned integer type");
+
+		I bits;
+
+		unorm() = default;
+
+		unorm(const float& value)
+			: bits(static_cast<I>(std::lrint(gmath::clamp(value, 0.0f, 1.0f) * std::numeric_limits<I>::max()))) {}
+
+		operator float() const
+		{
+			return static_cast<float>(bits) * (1.0f / std::numeric_limits<I>::max());
+		}
+	};
+
+	using snorm8 = snorm<int8_t>;
+	using snorm16 = snorm<int16_t>;
+	using unorm8 = unorm<uint8_t>;
+	using unorm16 = unorm<uint16_t>;
+
+	/*
+	* Bulk conversion of flat scalar arrays, vectorized with SSE2 and F16C when the compiler targets it.
+	*/
+
+	inline void convert(const float* src, half* dst, size_t count)
+	{
+		parallel_batch(count, [=](size_t first, size_t last)
+		{
+			size_t i = first;
+#ifdef GMATH_F16C
+			for (; i + 8 <= last; i += 8)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+			for (; i < last; i++)
+				dst[i] = half(src[i]);
+		});
+	}
+
+	inline void convert(const half* src, float* dst, size_t count)
+	{
+		parallel_batch(count, [=](size_t first, size_t last)
+		{
+			size_t i = first;
+#ifdef GMATH_F16C
+			for (; i + 8 <= last; i += 8)
+				_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+#endif
+			for (; i < last; i++)
+				dst[i] = src[i];
+		});
+	}
+
+	inline void convert(const float* src, snorm16* dst, size_t count)
+	{
+		parallel_batch(count, [=](size_t first, size_t last)
+		{
+			const __m128 lo = _mm_set1_ps(-1.0f);
+			const __m128 hi = _mm_set1_ps(1.0f);
+			const __m128 scale = _mm_set1_ps(32767.0f);
+
+			size_t i = first;
+			for (; i + 8 <= last; i += 8)
+			{
+				__m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi), scale);
+				__m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), lo), hi), scale);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+			}
+			for (; i < last; i++)
+				dst[i] = snorm16(src[i]);
+		});
+	}
+
+	inline void convert(const snorm16* src, float* dst, size_t count)
+	{
+		parallel_batch(count, [=](size_t first, size_t last)
+		{
+			const __m128 lo = _mm_set1_ps(-1.0f);
+			const __m128 scale = _mm_set1_ps(1.0f / 32767.0f);
+
+			size_t i = first;
+			for (; i + 8 <= last; i += 8)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				// Sign extension by unpacking into the high half and shifting back down
+				__m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+				__m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+				_mm_storeu_ps(dst + i, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(a), scale), lo));
+				_mm_storeu_ps(dst + i + 4, _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(b), scale), lo));
+			}
+			for (; i < last; i++)
+				dst[i] = src[i];
+		});
+	}
+
+	inline void convert(const float* src, unorm8* dst, size_t count)
+	{
+		parallel_batch(count, [=](size_t first, size_t last)
+		{
+			const __m128 lo = _mm_setzero_ps();
+			const __m128 hi = _mm_set1_ps(1.0f);
+			const __m128 scale = _mm_set1_ps(255.0f);
+
+			size_t i = first;
+			for (; i + 16 <= last; i += 16)
+			{
+				__m128i q[4];
+				for (size_t j = 0; j < 4; j++)
+					q[j] = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + j * 4), lo), hi), scale));
+				__m128i words = _mm_packs_epi32(q[0], q[1]);
+				__m128i words_hi = _mm_packs_epi32(q[2], q[3]);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words_hi));
+			}
+			for (; i < last; i++)
+				dst[i] = unorm8(src[i]);
+		});
+	}
+
+	inline void convert(const unorm8* src, float* dst, size_t count)
+	{
+		parallel_batch(count, [=](size_t first, size_t last)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+
+			size_t i = first;
+			for (; i + 16 <= last; i += 16)
+			{
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i words[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+				for (size_t j = 0; j < 2; j++)
+				{
+					_mm_storeu_ps(dst + i + j * 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words[j], zero)), scale));
+					_mm_storeu_ps(dst + i + j * 8 + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words[j], zero)), scale));
+				}
+			}
+			for (; i < last; i++)
+				dst[i] = src[i];
+		});
+	}
+
+	// Scalar fallback for the remaining combinations
+	template<typename From, typename To>
+	void convert(const From* src, To* dst, size_t count)
+	{
+		parallel_batch(count, [=](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+				dst[i] = To(static_cast<float>(src[i]));
+		});
+	}
+
+	// Vector arrays are tightly packed, so they are converted as one flat scalar array
+	template<typename From, typename To, size_t N>
+	void convert(const vector<From, N>* src, vector<To, N>* dst, size_t count)
+	{
+		static_assert(sizeof(vector<From, N>) == sizeof(From) * N && sizeof(vector<To, N>) == sizeof(To) * N, "vectors must be tightly packed");
+		convert(reinterpret_cast<const From*>(src), reinterpret_cast<To*>(dst), count * N);
+	}
+
+	using vec2_half = vector<half, 2>;
+	using vec3_half = vector<half, 3>;
+	using vec4_half = vector<half, 4>;
+	using vec3_snorm16 = vector<snorm16, 3>;
+	using vec4_snorm16 = vector<snorm16, 4>;
+	using vec4_unorm8 = vector<unorm8, 4>;
+}
\ No newline at end of file
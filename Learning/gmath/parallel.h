@@ -0,0 +1,365 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "platform.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace gmath
+{
+	/*
+	* Work-stealing thread pool behind parallel_for.
+	* A range is cut into chunks which are dealt round-robin over per-thread queues. Every thread takes chunks from the
+	* front of its own queue and steals from the back of the others once it runs dry. The calling thread takes part as well,
+	* so a pool of n threads runs n - 1 workers.
+	*/
+
+	struct parallel_config
+	{
+		// Threads including the caller, 1 runs everything inline
+		size_t threads{ std::max<size_t>(1, std::thread::hardware_concurrency()) };
+		// Pin worker i to core (first_core + i) % cores, the caller is left alone
+		bool pin_threads{ false };
+		size_t first_core{ 1 };
+		// Chunks are exactly grain elements, so they only depend on the range and not on the thread count
+		bool deterministic{ false };
+		// Elements per chunk of the library's batch kernels, smaller batches are not split at all
+		size_t batch_grain{ 16384 };
+	};
+
+	class thread_pool
+	{
+	public:
+		explicit thread_pool(const parallel_config& config)
+			: queues(std::max<size_t>(1, config.threads))
+		{
+			size_t workers = queues.size() - 1;
+			size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+			threads.reserve(workers);
+			for (size_t i = 0; i < workers; i++)
+			{
+				threads.emplace_back([this, i] { work(i); });
+				if (config.pin_threads)
+					pin(threads.back(), (config.first_core + i) % cores);
+			}
+		}
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		~thread_pool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(sleep_mutex);
+				stopping = true;
+			}
+			sleep_condition.notify_all();
+			for (std::thread& t : threads)
+				t.join();
+		}
+
+		size_t size() const
+		{
+			return queues.size();
+		}
+
+		// Calls fn(chunk) for every chunk in [0, chunks) and returns when all of them are done
+		template<typename F>
+		void run(size_t chunks, F& fn)
+		{
+			job j;
+			j.context = &fn;
+			j.call = [](void* context, size_t chunk) { (*static_cast<F*>(context))(chunk); };
+			j.remaining.store(chunks, std::memory_order_relaxed);
+
+			// Callers that are not workers share the last queue
+			size_t own = current_index() < threads.size() ? current_index() : threads.size();
+			queued.fetch_add(chunks, std::memory_order_release);
+			for (size_t q = 0; q < queues.size(); q++)
+			{
+				queue& target = queues[(own + q) % queues.size()];
+				std::lock_guard<std::mutex> lock(target.mutex);
+				for (size_t chunk = q; chunk < chunks; chunk += queues.size())
+					target.tasks.push_back({ &j, chunk });
+			}
+			{
+				// Orders the queued update with workers that are about to fall asleep
+				std::lock_guard<std::mutex> lock(sleep_mutex);
+			}
+			sleep_condition.notify_all();
+
+			// Help with any queued work, this one's or a nested job's, until the last chunk has been taken
+			task t;
+			while (j.remaining.load(std::memory_order_acquire) != 0 && take(own, t))
+				execute(t);
+
+			// The chunk that finishes last signals under the lock, so j stays alive until it is done with it
+			std::unique_lock<std::mutex> lock(j.mutex);
+			j.condition.wait(lock, [&j] { return j.done; });
+
+			if (j.error)
+				std::rethrow_exception(j.error);
+		}
+
+	private:
+		struct job
+		{
+			void* context{};
+			void (*call)(void*, size_t){};
+			std::atomic<size_t> remaining{};
+			std::atomic<bool> failed{};
+			std::exception_ptr error;
+			std::mutex mutex;
+			std::condition_variable condition;
+			bool done{};
+		};
+
+		struct task
+		{
+			job* owner;
+			size_t chunk;
+		};
+
+		struct queue
+		{
+			std::mutex mutex;
+			std::deque<task> tasks;
+		};
+
+		static size_t& current_index()
+		{
+			thread_local size_t index = SIZE_MAX;
+			return index;
+		}
+
+		static void pin(std::thread& thread, size_t core)
+		{
+#ifdef _WIN32
+			if (core < 64)
+				SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+#else
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(core, &set);
+			pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#endif
+		}
+
+		bool take(size_t index, task& t)
+		{
+			{
+				std::lock_guard<std::mutex> lock(queues[index].mutex);
+				if (!queues[index].tasks.empty())
+				{
+					t = queues[index].tasks.front();
+					queues[index].tasks.pop_front();
+					queued.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+			for (size_t i = 1; i < queues.size(); i++)
+			{
+				queue& victim = queues[(index + i) % queues.size()];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (!victim.tasks.empty())
+				{
+					t = victim.tasks.back();
+					victim.tasks.pop_back();
+					queued.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		static void execute(const task& t)
+		{
+			job& j = *t.owner;
+			if (!j.failed.load(std::memory_order_relaxed))
+			{
+				try
+				{
+					j.call(j.context, t.chunk);
+				}
+				catch (...)
+				{
+					if (!j.failed.exchange(true))
+						j.error = std::current_exception();
+				}
+			}
+			if (j.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				std::lock_guard<std::mutex> lock(j.mutex);
+				j.done = true;
+				j.condition.notify_all();
+			}
+		}
+
+		void work(size_t index)
+		{
+			current_index() = index;
+			while (true)
+			{
+				task t;
+				if (take(index, t))
+				{
+					execute(t);
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(sleep_mutex);
+				sleep_condition.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) != 0; });
+				if (stopping && queued.load(std::memory_order_acquire) == 0)
+					return;
+			}
+		}
+
+		std::vector<queue> queues;
+		std::vector<std::thread> threads;
+		std::atomic<size_t> queued{};
+		std::mutex sleep_mutex;
+		std::condition_variable sleep_condition;
+		bool stopping{};
+	};
+
+	namespace detail
+	{
+		struct parallel_state
+		{
+			parallel_config config;
+			std::unique_ptr<thread_pool> pool;
+			std::mutex mutex;
+
+			static parallel_state& get()
+			{
+				static parallel_state state;
+				return state;
+			}
+		};
+	}
+
+	inline parallel_config get_parallel_config()
+	{
+		detail::parallel_state& state = detail::parallel_state::get();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		return state.config;
+	}
+
+	// Replaces the shared pool, must not be called while a parallel_for is running
+	inline void set_parallel_config(const parallel_config& config)
+	{
+		detail::parallel_state& state = detail::parallel_state::get();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.pool.reset();
+		state.config = config;
+	}
+
+	// The shared pool is created on first use
+	inline thread_pool& default_thread_pool()
+	{
+		detail::parallel_state& state = detail::parallel_state::get();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (!state.pool)
+			state.pool = std::make_unique<thread_pool>(state.config);
+		return *state.pool;
+	}
+
+	/*
+	* Elements per chunk parallel_for uses for count elements, every chunk but the last one has exactly this size.
+	* Chunks of 64 elements or more are rounded up to a multiple of 64, so element kernels split on whole registers of
+	* any width and only the last chunk of the range has a scalar tail. Smaller chunks are rows or tiles and stay as is.
+	*/
+	inline size_t parallel_chunk_size(size_t count, size_t grain)
+	{
+		constexpr size_t alignment = 64;
+
+		grain = std::max<size_t>(1, grain);
+		parallel_config config = get_parallel_config();
+		if (config.deterministic)
+			return grain;
+		size_t target_chunks = std::max<size_t>(1, config.threads) * 4;
+		size_t chunk_size = std::max(grain, (count + target_chunks - 1) / target_chunks);
+		return chunk_size < alignment ? chunk_size : (chunk_size + alignment - 1) / alignment * alignment;
+	}
+
+	// Number of chunks parallel_for cuts count elements into, for sizing per-chunk results
+	inline size_t parallel_chunk_count(size_t count, size_t grain)
+	{
+		size_t chunk_size = parallel_chunk_size(count, grain);
+		return (count + chunk_size - 1) / chunk_size;
+	}
+
+	/*
+	* Calls fn(first, last) over chunks of at least grain elements of [first, last), or fn(chunk, first, last) when fn accepts
+	* the chunk index as well. Ranges of one chunk run inline on the calling thread.
+	* Exceptions thrown by fn are rethrown by parallel_for once every started chunk is done.
+	*/
+	template<typename F>
+	void parallel_for(size_t first, size_t last, size_t grain, F&& fn)
+	{
+		if (first >= last)
+			return;
+
+		size_t count = last - first;
+		size_t chunk_size = parallel_chunk_size(count, grain);
+		size_t chunks = (count + chunk_size - 1) / chunk_size;
+
+		auto body = [&](size_t chunk)
+		{
+			size_t begin = first + chunk * chunk_size;
+			size_t end = std::min(last, begin + chunk_size);
+			if constexpr (std::is_invocable_v<F&, size_t, size_t, size_t>)
+				fn(chunk, begin, end);
+			else
+				fn(begin, end);
+		};
+
+		if (chunks == 1)
+		{
+			body(0);
+			return;
+		}
+
+		thread_pool& pool = default_thread_pool();
+		if (pool.size() == 1)
+		{
+			for (size_t chunk = 0; chunk < chunks; chunk++)
+				body(chunk);
+			return;
+		}
+		pool.run(chunks, body);
+	}
+
+	template<typename F>
+	void parallel_for(size_t count, size_t grain, F&& fn)
+	{
+		parallel_for(0, count, grain, std::forward<F>(fn));
+	}
+
+	// Batch kernels split their input with the configured grain, so small batches never touch the pool
+	template<typename F>
+	void parallel_batch(size_t count, F&& fn)
+	{
+		size_t grain = get_parallel_config().batch_grain;
+		if (count < grain * 2)
+		{
+			fn(size_t(0), count);
+			return;
+		}
+		parallel_for(0, count, grain, std::forward<F>(fn));
+	}
+}
\ No newline at end of file
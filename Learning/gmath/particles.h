@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "gmath.h"
+#include "vec.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace gmath
+{
+	/*
+	* Particle system with structure of arrays storage.
+	* Every component lives in its own float stream, so one update loads a register of x, of y and of z at a time and
+	* applies gravity, drag, integration, the bounds and aging in a single pass, instead of one pass per vector operator.
+	* Chunks of parallel_for integrate independently and count the particles that expired, which are then removed by
+	* moving the last particle into their slot. Removal does not keep the order of the particles.
+	*/
+
+	enum class particle_integrator
+	{
+		// v += a * dt, x += v * dt
+		semi_implicit_euler,
+		// Time corrected position Verlet, stores the displacement of the last step instead of the velocity
+		verlet
+	};
+
+	struct particle_config
+	{
+		particle_integrator integrator{ particle_integrator::semi_implicit_euler };
+		vec3 gravity{ 0.0f, -9.81f, 0.0f };
+		// Velocity lost per second, applied implicitly as v / (1 + drag * dt) so large steps stay stable
+		float drag{};
+		// Particles bounce off the inside of [bounds_min, bounds_max] when bounded is set
+		bool bounded{};
+		vec3 bounds_min{ -1.0f, -1.0f, -1.0f };
+		vec3 bounds_max{ 1.0f, 1.0f, 1.0f };
+		// Fraction of the velocity into a wall that is kept, reversed
+		float restitution{ 0.5f };
+	};
+
+	class particle_system
+	{
+	public:
+		static constexpr size_t lanes = simd_native_width<float>();
+
+		explicit particle_system(const particle_config& config = {})
+			: settings(config) {}
+
+		size_t size() const
+		{
+			return ages.size();
+		}
+
+		void reserve(size_t count)
+		{
+			for (size_t d = 0; d < 3; d++)
+			{
+				positions[d].reserve(count);
+				motions[d].reserve(count);
+			}
+			ages.reserve(count);
+			lifetimes.reserve(count);
+		}
+
+		void clear()
+		{
+			for (size_t d = 0; d < 3; d++)
+			{
+				positions[d].clear();
+				motions[d].clear();
+			}
+			ages.clear();
+			lifetimes.clear();
+		}
+
+		// Adds a particle that lives for lifetime seconds and returns its index, which is valid until the next update
+		size_t emit(const vec3& position, const vec3& velocity, float lifetime)
+		{
+			// Verlet particles start with the displacement they would have had over the last step
+			float scale = settings.integrator == particle_integrator::verlet ? step : 1.0f;
+			for (size_t d = 0; d < 3; d++)
+			{
+				positions[d].push_back(position[d]);
+				motions[d].push_back(velocity[d] * scale);
+			}
+			ages.push_back(0.0f);
+			lifetimes.push_back(lifetime);
+			return ages.size() - 1;
+		}
+
+		vec3 position(size_t i) const
+		{
+			return vec3{ positions[0][i], positions[1][i], positions[2][i] };
+		}
+
+		vec3 velocity(size_t i) const
+		{
+			float scale = settings.integrator == particle_integrator::verlet ? 1.0f / step : 1.0f;
+			return vec3{ motions[0][i] * scale, motions[1][i] * scale, motions[2][i] * scale };
+		}
+
+		float age(size_t i) const
+		{
+			return ages[i];
+		}
+
+		// Stream of one position component, x, y or z, for uploading or further processing
+		const float* position_data(size_t axis) const
+		{
+			return positions[axis].data();
+		}
+
+		const particle_config& config() const
+		{
+			return settings;
+		}
+
+		// Changing the integrator of a live system converts the stored velocities to the new form
+		void configure(const particle_config& config)
+		{
+			if (config.integrator != settings.integrator)
+			{
+				float scale = config.integrator == particle_integrator::verlet ? step : 1.0f / step;
+				parallel_batch(size(), [&](size_t first, size_t last)
+				{
+					for (size_t d = 0; d < 3; d++)
+					{
+						for (size_t i = first; i < last; i++)
+							motions[d][i] *= scale;
+					}
+				});
+			}
+			settings = config;
+		}
+
+		/*
+		* Advances every particle by dt seconds and removes the ones whose age reached their lifetime.
+		* Returns the number of removed particles.
+		*/
+		size_t update(float dt)
+		{
+			if (!(dt > 0.0f))
+				throw std::runtime_error("gmath: particle time steps must be positive");
+
+			size_t count = size();
+			size_t grain = get_parallel_config().batch_grain;
+			std::vector<size_t> expired(count == 0 ? 0 : parallel_chunk_count(count, grain), 0);
+			parallel_for(count, grain, [&](size_t chunk, size_t first, size_t last)
+			{
+				size_t done = first + (last - first) / lanes * lanes;
+				expired[chunk] += integrate<lanes>(first, done, dt);
+				expired[chunk] += integrate<1>(done, last, dt);
+			});
+			step = dt;
+
+			size_t dead = 0;
+			for (size_t n : expired)
+				dead += n;
+			if (dead > 0)
+				compact();
+			return dead;
+		}
+
+	private:
+		particle_config settings;
+		std::vector<float> positions[3];
+		// Velocity for semi-implicit Euler, displacement over the last step for Verlet
+		std::vector<float> motions[3];
+		std::vector<float> ages;
+		std::vector<float> lifetimes;
+		// Length of the last step, Verlet scales the stored displacement by dt / step
+		float step{ 1.0f / 60.0f };
+
+		// Integrates [first, last), a multiple of W, and returns how many of these particles expired
+		template<size_t W>
+		size_t integrate(size_t first, size_t last, float dt)
+		{
+			using V = simd<float, W>;
+
+			bool verlet = settings.integrator == particle_integrator::verlet;
+			V time(dt);
+			V damping(1.0f / (1.0f + std::max(0.0f, settings.drag) * dt));
+			V bounce(-settings.restitution);
+			V rescale(dt / step);
+			V acceleration[3], low[3], high[3];
+			for (size_t d = 0; d < 3; d++)
+			{
+				// Verlet adds a * dt^2 to the displacement, Euler a * dt to the velocity
+				acceleration[d] = V(settings.gravity[d] * (verlet ? dt * dt : dt));
+				low[d] = V(settings.bounds_min[d]);
+				high[d] = V(settings.bounds_max[d]);
+			}
+
+			// Counted per lane, exact in floats up to 2^24 particles per lane and chunk
+			V dead(0.0f);
+			for (size_t i = first; i < last; i += W)
+			{
+				for (size_t d = 0; d < 3; d++)
+				{
+					V x = V::load(positions[d].data() + i);
+					V m = V::load(motions[d].data() + i);
+					if (verlet)
+					{
+						m = fma(m, rescale, acceleration[d]) * damping;
+						x += m;
+					}
+					else
+					{
+						m = (m + acceleration[d]) * damping;
+						x = fma(m, time, x);
+					}
+
+					if (settings.bounded)
+					{
+						// Clamp into the box and reverse the motion into the wall that was crossed
+						auto below = x < low[d];
+						auto above = x > high[d];
+						x = min(max(x, low[d]), high[d]);
+						m = select((below & (m < V(0.0f))) | (above & (m > V(0.0f))), m * bounce, m);
+					}
+					x.store(positions[d].data() + i);
+					m.store(motions[d].data() + i);
+				}
+
+				V age = V::load(ages.data() + i) + time;
+				age.store(ages.data() + i);
+				dead += select(age >= V::load(lifetimes.data() + i), V(1.0f), V(0.0f));
+			}
+			return static_cast<size_t>(reduce_add(dead));
+		}
+
+		// Moves the last live particle into the slot of every expired one
+		void compact()
+		{
+			size_t count = size();
+			size_t i = 0;
+			while (i < count)
+			{
+				if (ages[i] < lifetimes[i])
+				{
+					i++;
+					continue;
+				}
+
+				count--;
+				for (size_t d = 0; d < 3; d++)
+				{
+					positions[d][i] = positions[d][count];
+					motions[d][i] = motions[d][count];
+				}
+				ages[i] = ages[count];
+				lifetimes[i] = lifetimes[count];
+			}
+
+			for (size_t d = 0; d < 3; d++)
+			{
+				positions[d].resize(count);
+				motions[d].resize(count);
+			}
+			ages.resize(count);
+			lifetimes.resize(count);
+		}
+	};
+}
\ No newline at end of file
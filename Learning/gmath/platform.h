@@ -0,0 +1,18 @@
+#pragma once
+
+/*
+* Platform headers shared by the modules that talk to the operating system.
+*/
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+// windows.h still defines these for 16-bit pointers, they collide with near/far plane parameters
+#undef near
+#undef far
+#endif
\ No newline at end of file
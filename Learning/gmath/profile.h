@@ -0,0 +1,301 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+/*
+* Opt-in hot path instrumentation.
+* Define GMATH_PROFILE before including any gmath header to count calls of the main entry points,
+* and additionally GMATH_PROFILE_TIMING to sample their duration in cycles (1 in GMATH_PROFILE_SAMPLE_RATE calls).
+* Without GMATH_PROFILE the scope macro expands to nothing and the report functions are empty.
+*/
+
+#ifdef GMATH_PROFILE
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <limits>
+#include <mutex>
+#ifdef GMATH_PROFILE_TIMING
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+#endif
+
+#ifndef GMATH_PROFILE_SAMPLE_RATE
+#define GMATH_PROFILE_SAMPLE_RATE 64
+#endif
+
+namespace gmath
+{
+	enum class profile_point : uint32_t
+	{
+		matrix_multiply,
+		matrix_inverse,
+		vector_magnitude,
+		vector_normalize,
+		sin,
+		sqrt,
+		random,
+		color_add,
+		color_subtract,
+		color_multiply,
+		color_divide,
+		color_grayscale,
+		color_lerp,
+		count
+	};
+
+	inline const char* profile_point_name(const profile_point point)
+	{
+		static const char* names[] = {
+			"matrix::operator*",
+			"matrix::inverse",
+			"vector_base::magnitude",
+			"vector_base::normalize",
+			"gmath::sin",
+			"gmath::sqrt",
+			"gmath::random",
+			"color_base::operator+=",
+			"color_base::operator-=",
+			"color_base::operator*=",
+			"color_base::operator/=",
+			"color_base::grayscale",
+			"color_base::lerp"
+		};
+		return names[static_cast<uint32_t>(point)];
+	}
+
+	struct profile_entry
+	{
+		profile_point point;
+		uint64_t calls;
+		uint64_t samples;
+		uint64_t cycles;
+
+		// Total cycles extrapolated from the sampled calls, in double since cycles * calls overflows, saturating
+		uint64_t estimated_cycles() const
+		{
+			if (samples == 0)
+				return 0;
+			double estimate = static_cast<double>(cycles) / static_cast<double>(samples) * static_cast<double>(calls);
+			if (estimate >= static_cast<double>(std::numeric_limits<uint64_t>::max()))
+				return std::numeric_limits<uint64_t>::max();
+			return static_cast<uint64_t>(estimate);
+		}
+	};
+
+#ifdef GMATH_PROFILE
+	namespace detail
+	{
+		constexpr size_t profile_point_count = static_cast<size_t>(profile_point::count);
+
+		/*
+		* Written only by the owning thread with relaxed stores, so counting never needs a locked instruction.
+		* A reset cannot store into them without racing the owner, it records the counts at that moment in the
+		* base arrays instead, which are only touched under the registry mutex.
+		*/
+		struct profile_counters
+		{
+			std::atomic<uint64_t> calls[profile_point_count]{};
+			std::atomic<uint64_t> samples[profile_point_count]{};
+			std::atomic<uint64_t> cycles[profile_point_count]{};
+			uint64_t base_calls[profile_point_count]{};
+			uint64_t base_samples[profile_point_count]{};
+			uint64_t base_cycles[profile_point_count]{};
+
+			// Counts since the last reset, the caller holds the registry mutex
+			uint64_t calls_since_reset(size_t i) const
+			{
+				return calls[i].load(std::memory_order_relaxed) - base_calls[i];
+			}
+
+			uint64_t samples_since_reset(size_t i) const
+			{
+				return samples[i].load(std::memory_order_relaxed) - base_samples[i];
+			}
+
+			uint64_t cycles_since_reset(size_t i) const
+			{
+				return cycles[i].load(std::memory_order_relaxed) - base_cycles[i];
+			}
+		};
+
+		struct profile_registry
+		{
+			std::mutex mutex;
+			std::vector<profile_counters*> threads;
+			uint64_t calls[profile_point_count]{};
+			uint64_t samples[profile_point_count]{};
+			uint64_t cycles[profile_point_count]{};
+
+			static profile_registry& get()
+			{
+				static profile_registry registry;
+				return registry;
+			}
+		};
+
+		struct profile_thread
+		{
+			profile_counters counters;
+
+			profile_thread()
+			{
+				profile_registry& registry = profile_registry::get();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				registry.threads.push_back(&counters);
+			}
+
+			// Counts of finished threads are folded into the registry so they survive the thread
+			~profile_thread()
+			{
+				profile_registry& registry = profile_registry::get();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				for (size_t i = 0; i < profile_point_count; i++)
+				{
+					registry.calls[i] += counters.calls_since_reset(i);
+					registry.samples[i] += counters.samples_since_reset(i);
+					registry.cycles[i] += counters.cycles_since_reset(i);
+				}
+				registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &counters));
+			}
+
+			static profile_counters& local()
+			{
+				thread_local profile_thread thread;
+				return thread.counters;
+			}
+		};
+
+		inline void profile_add(std::atomic<uint64_t>& counter, uint64_t value)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+	}
+
+	class profile_scope
+	{
+	public:
+		explicit profile_scope(const profile_point point)
+			: index(static_cast<size_t>(point))
+		{
+			detail::profile_counters& counters = detail::profile_thread::local();
+			uint64_t calls = counters.calls[index].load(std::memory_order_relaxed);
+			counters.calls[index].store(calls + 1, std::memory_order_relaxed);
+#ifdef GMATH_PROFILE_TIMING
+			if (calls % GMATH_PROFILE_SAMPLE_RATE == 0)
+				start = __rdtsc();
+#endif
+		}
+
+		profile_scope(const profile_scope&) = delete;
+		profile_scope& operator=(const profile_scope&) = delete;
+
+#ifdef GMATH_PROFILE_TIMING
+		~profile_scope()
+		{
+			if (start)
+			{
+				detail::profile_counters& counters = detail::profile_thread::local();
+				detail::profile_add(counters.cycles[index], __rdtsc() - start);
+				detail::profile_add(counters.samples[index], 1);
+			}
+		}
+#endif
+
+	private:
+		size_t index;
+#ifdef GMATH_PROFILE_TIMING
+		uint64_t start{};
+#endif
+	};
+
+	// Merges the counters of all live and finished threads, sorted by estimated cycles and then by calls
+	inline std::vector<profile_entry> profile_snapshot()
+	{
+		detail::profile_registry& registry = detail::profile_registry::get();
+		std::vector<profile_entry> entries;
+
+		{
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			for (size_t i = 0; i < detail::profile_point_count; i++)
+			{
+				profile_entry entry{ static_cast<profile_point>(i), registry.calls[i], registry.samples[i], registry.cycles[i] };
+				for (detail::profile_counters* counters : registry.threads)
+				{
+					entry.calls += counters->calls_since_reset(i);
+					entry.samples += counters->samples_since_reset(i);
+					entry.cycles += counters->cycles_since_reset(i);
+				}
+				if (entry.calls)
+					entries.push_back(entry);
+			}
+		}
+
+		std::sort(entries.begin(), entries.end(), [](const profile_entry& a, const profile_entry& b)
+		{
+			if (a.estimated_cycles() != b.estimated_cycles())
+				return a.estimated_cycles() > b.estimated_cycles();
+			return a.calls > b.calls;
+		});
+		return entries;
+	}
+
+	// Clears finished thread totals and moves the baseline of live threads to their current counts
+	inline void profile_reset()
+	{
+		detail::profile_registry& registry = detail::profile_registry::get();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for (size_t i = 0; i < detail::profile_point_count; i++)
+		{
+			registry.calls[i] = registry.samples[i] = registry.cycles[i] = 0;
+			for (detail::profile_counters* counters : registry.threads)
+			{
+				counters->base_calls[i] = counters->calls[i].load(std::memory_order_relaxed);
+				counters->base_samples[i] = counters->samples[i].load(std::memory_order_relaxed);
+				counters->base_cycles[i] = counters->cycles[i].load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	inline void profile_dump(std::ostream& stream = std::cout)
+	{
+		std::vector<profile_entry> entries = profile_snapshot();
+
+		uint64_t total_cycles{};
+		for (const profile_entry& entry : entries)
+			total_cycles += entry.estimated_cycles();
+
+		stream << std::format("{:<26} {:>14} {:>12} {:>18} {:>7}\n", "entry point", "calls", "cycles/call", "est. cycles", "share");
+		for (const profile_entry& entry : entries)
+		{
+			double per_call = entry.samples ? static_cast<double>(entry.cycles) / entry.samples : 0.0;
+			double share = total_cycles ? 100.0 * entry.estimated_cycles() / total_cycles : 0.0;
+			stream << std::format("{:<26} {:>14} {:>12.1f} {:>18} {:>6.1f}%\n", profile_point_name(entry.point), entry.calls, per_call, entry.estimated_cycles(), share);
+		}
+	}
+#else
+	inline std::vector<profile_entry> profile_snapshot()
+	{
+		return {};
+	}
+
+	inline void profile_reset() {}
+
+	inline void profile_dump(std::ostream& stream = std::cout)
+	{
+		stream << "gmath profiling is disabled, define GMATH_PROFILE to enable it\n";
+	}
+#endif
+}
+
+#ifdef GMATH_PROFILE
+#define GMATH_PROFILE_SCOPE(point) ::gmath::profile_scope gmath_profile_scope_{ ::gmath::profile_point::point }
+#else
+#define GMATH_PROFILE_SCOPE(point) ((void)0)
+#endif
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "gmath.h"
+#include "vec.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace gmath
+{
+	/*
+	* Fused vertex projection: transform by a model-view-projection matrix, clip outcodes, perspective divide and
+	* viewport mapping in one pass over the vertices.
+	* Clip space follows matrix::perspective and matrix::orthographic, -w <= x, y, z <= w, and points are row vectors
+	* so the matrix is model * view * projection.
+	*/
+
+	struct viewport
+	{
+		float x{};
+		float y{};
+		float width{};
+		float height{};
+		float min_depth{ 0.0f };
+		float max_depth{ 1.0f };
+	};
+
+	// Clip planes a vertex is outside of, vertices behind the eye (w <= 0) are also outside the near plane
+	enum clip_outcode : uint8_t
+	{
+		clip_left = 1 << 0,
+		clip_right = 1 << 1,
+		clip_bottom = 1 << 2,
+		clip_top = 1 << 3,
+		clip_near = 1 << 4,
+		clip_far = 1 << 5
+	};
+
+	// any is the OR of all outcodes, nothing needs clipping when it is 0. all is the AND, every vertex is on the outside
+	// of the same plane when it is not 0
+	struct outcode_summary
+	{
+		uint8_t any{};
+		uint8_t all{};
+	};
+
+	/*
+	* Writes (x, y, depth, 1 / w) per vertex, x and y in pixels with y pointing down from the top of the viewport and
+	* depth mapped to [min_depth, max_depth]. 1 / w is kept for perspective correct interpolation.
+	* The screen position of a vertex with clip_near set is meaningless, outcodes may be null.
+	*/
+	inline outcode_summary project(const mat4& mvp, const viewport& vp, const vec3* src, vec4* dst, uint8_t* outcodes, size_t count)
+	{
+		constexpr size_t lanes = simd_native_width<float>();
+		using V = simd<float, lanes>;
+
+		outcode_summary summary{ 0, 0xFF };
+		if (count == 0)
+			return { 0, 0 };
+
+		size_t chunks = count < get_parallel_config().batch_grain * 2 ? 1 : parallel_chunk_count(count, get_parallel_config().batch_grain);
+		std::vector<outcode_summary> partial(chunks, summary);
+
+		auto body = [&](size_t chunk, size_t first, size_t last)
+		{
+			V m[16];
+			for (size_t e = 0; e < 16; e++)
+				m[e] = V(mvp.elements[e]);
+
+			// NDC to pixels, (ndc + 1) / 2 * size + offset as one multiply-add
+			V sx(0.5f * vp.width), ox(vp.x + 0.5f * vp.width);
+			V sy(-0.5f * vp.height), oy(vp.y + 0.5f * vp.height);
+			V sz(0.5f * (vp.max_depth - vp.min_depth)), oz(0.5f * (vp.max_depth + vp.min_depth));
+			V zero(0.0f);
+
+			outcode_summary local{ 0, 0xFF };
+			for (size_t i = first; i < last; i += lanes)
+			{
+				size_t n = std::min(lanes, last - i);
+				float px[lanes]{}, py[lanes]{}, pz[lanes]{};
+				for (size_t l = 0; l < n; l++)
+				{
+					px[l] = src[i + l].x;
+					py[l] = src[i + l].y;
+					pz[l] = src[i + l].z;
+				}
+				V x = V::load(px), y = V::load(py), z = V::load(pz);
+
+				V cx = fma(x, m[0], fma(y, m[4], fma(z, m[8], m[12])));
+				V cy = fma(x, m[1], fma(y, m[5], fma(z, m[9], m[13])));
+				V cz = fma(x, m[2], fma(y, m[6], fma(z, m[10], m[14])));
+				V cw = fma(x, m[3], fma(y, m[7], fma(z, m[11], m[15])));
+
+				V code = select(cx < -cw, V(float(clip_left)), zero)
+					+ select(cx > cw, V(float(clip_right)), zero)
+					+ select(cy < -cw, V(float(clip_bottom)), zero)
+					+ select(cy > cw, V(float(clip_top)), zero)
+					+ select((cz < -cw) | (cw <= zero), V(float(clip_near)), zero)
+					+ select(cz > cw, V(float(clip_far)), zero);
+
+				V inverse_w = V(1.0f) / cw;
+				float sx_out[lanes], sy_out[lanes], sz_out[lanes], w_out[lanes], codes[lanes];
+				fma(cx * inverse_w, sx, ox).store(sx_out);
+				fma(cy * inverse_w, sy, oy).store(sy_out);
+				fma(cz * inverse_w, sz, oz).store(sz_out);
+				inverse_w.store(w_out);
+				code.store(codes);
+
+				for (size_t l = 0; l < n; l++)
+				{
+					uint8_t c = static_cast<uint8_t>(codes[l]);
+					vec4& out = dst[i + l];
+					out.x = sx_out[l];
+					out.y = sy_out[l];
+					out.z = sz_out[l];
+					out.w = w_out[l];
+					if (outcodes)
+						outcodes[i + l] = c;
+					local.any |= c;
+					local.all &= c;
+				}
+			}
+			partial[chunk] = local;
+		};
+
+		if (chunks == 1)
+			body(0, 0, count);
+		else
+			parallel_for(count, get_parallel_config().batch_grain, body);
+
+		for (const outcode_summary& p : partial)
+		{
+			summary.any |= p.any;
+			summary.all &= p.all;
+		}
+		return summary;
+	}
+
+	inline outcode_summary project(const mat4& mvp, const viewport& vp, const std::vector<vec3>& src, std::vector<vec4>& dst, std::vector<uint8_t>* outcodes = nullptr)
+	{
+		dst.resize(src.size());
+		if (outcodes)
+			outcodes->resize(src.size());
+		return project(mvp, vp, src.data(), dst.data(), outcodes ? outcodes->data() : nullptr, src.size());
+	}
+}
\ No newline at end of file
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "gmath.h"
+#include "vec.h"
+#include "color.h"
+#include "image.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace gmath
+{
+	/*
+	* Tile based triangle rasterizer into color_base buffers with a float depth buffer.
+	* Triangles are set up and binned into screen tiles in parallel, then every tile is rasterized by one thread, so
+	* no two threads ever touch the same pixel and draw order is kept within a tile. Pixels are walked a register at a time
+	* with edge functions sampled at pixel centres and the top-left fill rule, so shared edges are drawn exactly once.
+	* Depth is interpolated linearly in screen space, colours perspective correct through 1 / w.
+	*/
+
+	struct raster_config
+	{
+		size_t tile_size{ 64 };
+		// Drops triangles that are clockwise in normalized device coordinates, the back faces of counter-clockwise meshes
+		bool cull_backfaces{ false };
+	};
+
+	template<typename T>
+	class rasterizer
+	{
+		static_assert(std::is_integral_v<T>, "rasterizer writes integer colour types such as color and color16");
+
+	public:
+		explicit rasterizer(const raster_config& config = {})
+			: config(config) {}
+
+		// Fills both buffers, rows are cleared in parallel
+		static void clear(const image_view<color_base<T>>& target, const color_base<T>& c, const image_view<float>& depth, float d = 1.0f)
+		{
+			size_t grain = std::max<size_t>(1, get_parallel_config().batch_grain / std::max<size_t>(1, target.width));
+			parallel_for(std::max(target.height, depth.height), grain, [&](size_t first, size_t last)
+			{
+				for (size_t y = first; y < last; y++)
+				{
+					if (y < target.height)
+						std::fill(target.row(y), target.row(y) + target.width, c);
+					if (y < depth.height)
+						std::fill(depth.row(y), depth.row(y) + depth.width, d);
+				}
+			});
+		}
+
+		/*
+		* Draws indexed triangles. vertices are the (x, y, depth, 1 / w) output of project(), a pixel is written when its
+		* depth is less than the stored one. Triangles with a vertex behind the eye are skipped rather than clipped.
+		* Returns the number of triangles that covered at least one tile.
+		*/
+		size_t draw(const image_view<color_base<T>>& target, const image_view<float>& depth, const vec4* vertices, const color_base<T>* colors, const uint32_t* indices, size_t triangles)
+		{
+			size_t width = std::min(target.width, depth.width);
+			size_t height = std::min(target.height, depth.height);
+			if (triangles == 0 || width == 0 || height == 0)
+				return 0;
+
+			size_t tile = std::max<size_t>(8, config.tile_size);
+			size_t tiles_x = (width + tile - 1) / tile;
+			size_t tiles_y = (height + tile - 1) / tile;
+			size_t tiles = tiles_x * tiles_y;
+
+			// Setup and binning, every chunk bins into its own lists so tiles can replay them in draw order
+			setups.resize(triangles);
+			size_t chunks = parallel_chunk_count(triangles, setup_grain);
+			if (bins.size() < chunks)
+				bins.resize(chunks);
+			std::vector<size_t> binned(chunks);
+			parallel_for(triangles, setup_grain, [&](size_t chunk, size_t first, size_t last)
+			{
+				std::vector<std::vector<uint32_t>>& lists = bins[chunk];
+				lists.resize(tiles);
+				for (std::vector<uint32_t>& list : lists)
+					list.clear();
+
+				for (size_t i = first; i < last; i++)
+				{
+					triangle_setup& s = setups[i];
+					const uint32_t* index = indices + i * 3;
+					if (!setup(s, vertices, colors, index, width, height))
+						continue;
+
+					size_t tx0 = s.min_x / tile, tx1 = (s.max_x - 1) / tile;
+					size_t ty0 = s.min_y / tile, ty1 = (s.max_y - 1) / tile;
+					for (size_t ty = ty0; ty <= ty1; ty++)
+					{
+						for (size_t tx = tx0; tx <= tx1; tx++)
+							lists[ty * tiles_x + tx].push_back(static_cast<uint32_t>(i));
+					}
+					binned[chunk]++;
+				}
+			});
+
+			parallel_for(tiles, 1, [&](size_t first, size_t last)
+			{
+				for (size_t t = first; t < last; t++)
+				{
+					size_t x0 = (t % tiles_x) * tile, y0 = (t / tiles_x) * tile;
+					size_t x1 = std::min(width, x0 + tile), y1 = std::min(height, y0 + tile);
+					for (size_t chunk = 0; chunk < chunks; chunk++)
+					{
+						for (uint32_t i : bins[chunk][t])
+							rasterize(setups[i], target, depth, x0, y0, x1, y1);
+					}
+				}
+			});
+
+			size_t total = 0;
+			for (size_t b : binned)
+				total += b;
+			return total;
+		}
+
+		size_t draw(const image_view<color_base<T>>& target, const image_view<float>& depth, const std::vector<vec4>& vertices, const std::vector<color_base<T>>& colors, const std::vector<uint32_t>& indices)
+		{
+			return draw(target, depth, vertices.data(), colors.data(), indices.data(), indices.size() / 3);
+		}
+
+	private:
+		static constexpr size_t lanes = simd_native_width<float>();
+		using lane_type = simd<float, lanes>;
+		static constexpr size_t setup_grain = 4096;
+
+		// Value at pixel centre (x, y) is c + dx * x + dy * y
+		struct plane
+		{
+			float dx, dy, c;
+		};
+
+		struct triangle_setup
+		{
+			plane edges[3];
+			bool top_left[3];
+			plane z;
+			plane inverse_w;
+			// Colour channels divided by w
+			plane channels[4];
+			size_t min_x, min_y, max_x, max_y;
+		};
+
+		raster_config config;
+		std::vector<triangle_setup> setups;
+		// Triangle indices per setup chunk and tile
+		std::vector<std::vector<std::vector<uint32_t>>> bins;
+
+		bool setup(triangle_setup& s, const vec4* vertices, const color_base<T>* colors, const uint32_t* index, size_t width, size_t height) const
+		{
+			vec4 v[3] = { vertices[index[0]], vertices[index[1]], vertices[index[2]] };
+			const color_base<T>* c[3] = { colors + index[0], colors + index[1], colors + index[2] };
+			for (size_t k = 0; k < 3; k++)
+			{
+				if (!(v[k].w > 0.0f) || !std::isfinite(v[k].x) || !std::isfinite(v[k].y))
+					return false;
+			}
+
+			// Screen y points down, so counter-clockwise in NDC has a negative area here
+			float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+			if (area == 0.0f || (config.cull_backfaces && area > 0.0f))
+				return false;
+			if (area < 0.0f)
+			{
+				std::swap(v[1], v[2]);
+				std::swap(c[1], c[2]);
+				area = -area;
+			}
+
+			float min_x = std::min({ v[0].x, v[1].x, v[2].x }), max_x = std::max({ v[0].x, v[1].x, v[2].x });
+			float min_y = std::min({ v[0].y, v[1].y, v[2].y }), max_y = std::max({ v[0].y, v[1].y, v[2].y });
+			// Pixel x is covered when its centre x + 0.5 is inside
+			s.min_x = static_cast<size_t>(std::clamp(std::floor(min_x - 0.5f) + 1.0f, 0.0f, static_cast<float>(width)));
+			s.max_x = static_cast<size_t>(std::clamp(std::floor(max_x - 0.5f) + 1.0f, 0.0f, static_cast<float>(width)));
+			s.min_y = static_cast<size_t>(std::clamp(std::floor(min_y - 0.5f) + 1.0f, 0.0f, static_cast<float>(height)));
+			s.max_y = static_cast<size_t>(std::clamp(std::floor(max_y - 0.5f) + 1.0f, 0.0f, static_cast<float>(height)));
+			if (s.min_x >= s.max_x || s.min_y >= s.max_y)
+				return false;
+
+			// Edge k is opposite vertex k and positive on the inside, divided by the area it is the barycentric weight of k
+			for (size_t k = 0; k < 3; k++)
+			{
+				// Both triangles of a shared edge compute it from the same ordered end points and one of them negates it,
+				// so the two edge values are exact opposites even when the compiler contracts to FMA
+				const vec4& from = v[(k + 1) % 3];
+				const vec4& to = v[(k + 2) % 3];
+				bool flip = to.x < from.x || (to.x == from.x && to.y < from.y);
+				const vec4& a = flip ? to : from;
+				const vec4& b = flip ? from : to;
+				plane& e = s.edges[k];
+				e.dx = a.y - b.y;
+				e.dy = b.x - a.x;
+				e.c = a.x * b.y - a.y * b.x + 0.5f * (e.dx + e.dy);
+				if (flip)
+					e = { -e.dx, -e.dy, -e.c };
+				// Interior to the right of a left edge, or below a horizontal top edge
+				s.top_left[k] = e.dx > 0.0f || (e.dx == 0.0f && e.dy > 0.0f);
+			}
+
+			auto interpolate = [&s, area](float a0, float a1, float a2)
+			{
+				plane p;
+				p.dx = (s.edges[0].dx * a0 + s.edges[1].dx * a1 + s.edges[2].dx * a2) / area;
+				p.dy = (s.edges[0].dy * a0 + s.edges[1].dy * a1 + s.edges[2].dy * a2) / area;
+				p.c = (s.edges[0].c * a0 + s.edges[1].c * a1 + s.edges[2].c * a2) / area;
+				return p;
+			};
+			s.z = interpolate(v[0].z, v[1].z, v[2].z);
+			s.inverse_w = interpolate(v[0].w, v[1].w, v[2].w);
+			for (size_t ch = 0; ch < 4; ch++)
+				s.channels[ch] = interpolate((*c[0])[ch] * v[0].w, (*c[1])[ch] * v[1].w, (*c[2])[ch] * v[2].w);
+			return true;
+		}
+
+		static lane_type evaluate(const plane& p, const lane_type& x, float y)
+		{
+			return fma(x, lane_type(p.dx), lane_type(p.dy * y + p.c));
+		}
+
+		static void rasterize(const triangle_setup& s, const image_view<color_base<T>>& target, const image_view<float>& depth, size_t x0, size_t y0, size_t x1, size_t y1)
+		{
+			size_t first_x = std::max(x0, s.min_x), last_x = std::min(x1, s.max_x);
+			size_t first_y = std::max(y0, s.min_y), last_y = std::min(y1, s.max_y);
+			if (first_x >= last_x || first_y >= last_y)
+				return;
+
+			float ramp[lanes];
+			for (size_t l = 0; l < lanes; l++)
+				ramp[l] = static_cast<float>(l);
+			lane_type offsets = lane_type::load(ramp);
+			lane_type zero(0.0f);
+			const float limit = static_cast<float>(std::numeric_limits<T>::max());
+
+			for (size_t y = first_y; y < last_y; y++)
+			{
+				float fy = static_cast<float>(y);
+				float* depth_row = depth.row(y);
+				color_base<T>* color_row = target.row(y);
+				for (size_t x = first_x; x < last_x; x += lanes)
+				{
+					size_t n = std::min(lanes, last_x - x);
+					lane_type px = offsets + lane_type(static_cast<float>(x));
+
+					auto inside = offsets < lane_type(static_cast<float>(n));
+					for (size_t k = 0; k < 3; k++)
+					{
+						lane_type e = evaluate(s.edges[k], px, fy);
+						inside = inside & (s.top_left[k] ? e >= zero : e > zero);
+					}
+					if (!inside.any())
+						continue;
+
+					float stored[lanes]{};
+					std::copy(depth_row + x, depth_row + x + n, stored);
+					lane_type z = evaluate(s.z, px, fy);
+					auto pass = inside & (z < lane_type::load(stored));
+					if (!pass.any())
+						continue;
+
+					select(pass, z, lane_type::load(stored)).store(stored);
+					std::copy(stored, stored + n, depth_row + x);
+
+					lane_type w = lane_type(1.0f) / evaluate(s.inverse_w, px, fy);
+					float channels[4][lanes], written[lanes];
+					for (size_t ch = 0; ch < 4; ch++)
+						min(max(fma(evaluate(s.channels[ch], px, fy), w, lane_type(0.5f)), zero), lane_type(limit)).store(channels[ch]);
+					select(pass, lane_type(1.0f), zero).store(written);
+
+					for (size_t l = 0; l < n; l++)
+					{
+						if (written[l] == 0.0f)
+							continue;
+						color_base<T>& out = color_row[x + l];
+						for (size_t ch = 0; ch < 4; ch++)
+							out[ch] = detail::channel_cast<T>(channels[ch][l]);
+					}
+				}
+			}
+		}
+	};
+}
\ No newline at end of file
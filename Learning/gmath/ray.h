@@ -0,0 +1,516 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <xmmintrin.h>
+
+#include "gmath.h"
+#include "vec.h"
+
+namespace gmath
+{
+	template<typename T>
+	struct ray_base
+	{
+		vec<T, 3> origin;
+		vec<T, 3> direction;
+
+		vec<T, 3> at(const T& t) const
+		{
+			return origin + direction * t;
+		}
+	};
+
+	/*
+	* Ray packets store W rays in SoA order so every component can be loaded straight into a SIMD register.
+	* W has to be a multiple of 4, each group of 4 lanes is processed with one SSE register.
+	*/
+
+	template<size_t W>
+	struct ray_packet
+	{
+		static_assert(W % 4 == 0 && W <= 32, "ray_packet width must be a multiple of 4 and at most 32");
+
+		alignas(16) float ox[W], oy[W], oz[W];
+		alignas(16) float dx[W], dy[W], dz[W];
+		alignas(16) float inv_dx[W], inv_dy[W], inv_dz[W];
+		alignas(16) float t_min[W], t_max[W];
+
+		void set(const size_t i, const ray_base<float>& r, const float& near = 0.0f, const float& far = std::numeric_limits<float>::infinity())
+		{
+			ox[i] = r.origin.x; oy[i] = r.origin.y; oz[i] = r.origin.z;
+			dx[i] = r.direction.x; dy[i] = r.direction.y; dz[i] = r.direction.z;
+			inv_dx[i] = 1.0f / r.direction.x;
+			inv_dy[i] = 1.0f / r.direction.y;
+			inv_dz[i] = 1.0f / r.direction.z;
+			t_min[i] = near;
+			t_max[i] = far;
+		}
+
+		ray_base<float> get(const size_t i) const
+		{
+			return { vec<float, 3>{ ox[i], oy[i], oz[i] }, vec<float, 3>{ dx[i], dy[i], dz[i] } };
+		}
+
+		// Marks lane i as inactive, inactive lanes never report a hit
+		void disable(const size_t i)
+		{
+			t_min[i] = std::numeric_limits<float>::infinity();
+			t_max[i] = -std::numeric_limits<float>::infinity();
+		}
+
+		static constexpr size_t size() { return W; }
+	};
+
+	// Per lane hit distance and barycentrics, only lanes set in the returned mask are written
+	template<size_t W>
+	struct hit_packet
+	{
+		alignas(16) float t[W];
+		alignas(16) float u[W];
+		alignas(16) float v[W];
+	};
+
+	/*
+	* Primitives packed in groups of 4 for testing a single ray against many primitives at once.
+	* Unused lanes are filled with primitives that can never be hit.
+	*/
+
+	struct aabb4
+	{
+		alignas(16) float min_x[4], min_y[4], min_z[4];
+		alignas(16) float max_x[4], max_y[4], max_z[4];
+	};
+
+	struct triangle4
+	{
+		alignas(16) float v0_x[4], v0_y[4], v0_z[4];
+		alignas(16) float e1_x[4], e1_y[4], e1_z[4];
+		alignas(16) float e2_x[4], e2_y[4], e2_z[4];
+	};
+
+	struct sphere4
+	{
+		alignas(16) float c_x[4], c_y[4], c_z[4];
+		alignas(16) float r2[4];
+	};
+
+	// Nearest hit of a single ray against a primitive span, index is the primitive index before packing
+	struct ray_hit
+	{
+		float t;
+		float u;
+		float v;
+		size_t index;
+	};
+
+	namespace detail
+	{
+		struct sse_vec3
+		{
+			__m128 x, y, z;
+		};
+
+		inline __m128 sse_dot(const sse_vec3& a, const sse_vec3& b)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+		}
+
+		inline sse_vec3 sse_cross(const sse_vec3& a, const sse_vec3& b)
+		{
+			return {
+				_mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+				_mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+				_mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x))
+			};
+		}
+
+		inline sse_vec3 sse_sub(const sse_vec3& a, const sse_vec3& b)
+		{
+			return { _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) };
+		}
+
+		inline sse_vec3 sse_broadcast(const vec<float, 3>& v)
+		{
+			return { _mm_set1_ps(v.x), _mm_set1_ps(v.y), _mm_set1_ps(v.z) };
+		}
+
+		inline __m128 sse_abs(const __m128& v)
+		{
+			return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+		}
+
+		// Slab test, the operand order of min/max makes NaNs from 0 * inf fall back to the running interval
+		inline __m128 sse_slab(const sse_vec3& o, const sse_vec3& inv_d, const sse_vec3& bmin, const sse_vec3& bmax, __m128& t_near, __m128 t_far)
+		{
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(bmin.x, o.x), inv_d.x);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(bmax.x, o.x), inv_d.x);
+			t_near = _mm_max_ps(_mm_min_ps(t0, t1), t_near);
+			t_far = _mm_min_ps(_mm_max_ps(t0, t1), t_far);
+
+			t0 = _mm_mul_ps(_mm_sub_ps(bmin.y, o.y), inv_d.y);
+			t1 = _mm_mul_ps(_mm_sub_ps(bmax.y, o.y), inv_d.y);
+			t_near = _mm_max_ps(_mm_min_ps(t0, t1), t_near);
+			t_far = _mm_min_ps(_mm_max_ps(t0, t1), t_far);
+
+			t0 = _mm_mul_ps(_mm_sub_ps(bmin.z, o.z), inv_d.z);
+			t1 = _mm_mul_ps(_mm_sub_ps(bmax.z, o.z), inv_d.z);
+			t_near = _mm_max_ps(_mm_min_ps(t0, t1), t_near);
+			t_far = _mm_min_ps(_mm_max_ps(t0, t1), t_far);
+
+			return _mm_cmple_ps(t_near, t_far);
+		}
+
+		// Moller-Trumbore, returns the hit mask and writes t, u and v for all lanes
+		inline __m128 sse_triangle(const sse_vec3& o, const sse_vec3& d, const sse_vec3& v0, const sse_vec3& e1, const sse_vec3& e2,
+			const __m128& t_min, const __m128& t_max, __m128& t, __m128& u, __m128& v)
+		{
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+
+			sse_vec3 p = sse_cross(d, e2);
+			__m128 det = sse_dot(e1, p);
+			__m128 inv_det = _mm_div_ps(one, det);
+
+			sse_vec3 s = sse_sub(o, v0);
+			u = _mm_mul_ps(sse_dot(s, p), inv_det);
+
+			sse_vec3 q = sse_cross(s, e1);
+			v = _mm_mul_ps(sse_dot(d, q), inv_det);
+			t = _mm_mul_ps(sse_dot(e2, q), inv_det);
+
+			__m128 mask = _mm_cmpgt_ps(sse_abs(det), _mm_set1_ps(std::numeric_limits<float>::min()));
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+			mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+			mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, t_min));
+			mask = _mm_and_ps(mask, _mm_cmplt_ps(t, t_max));
+			return mask;
+		}
+
+		// Nearest root of |o + t * d - c|^2 = r^2 inside (t_min, t_max)
+		inline __m128 sse_sphere(const sse_vec3& o, const sse_vec3& d, const sse_vec3& c, const __m128& r2,
+			const __m128& t_min, const __m128& t_max, __m128& t)
+		{
+			sse_vec3 oc = sse_sub(o, c);
+			__m128 a = sse_dot(d, d);
+			__m128 b = sse_dot(oc, d);
+			__m128 cc = _mm_sub_ps(sse_dot(oc, oc), r2);
+			__m128 disc = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, cc));
+			__m128 valid = _mm_cmpge_ps(disc, _mm_setzero_ps());
+
+			__m128 root = _mm_sqrt_ps(_mm_max_ps(disc, _mm_setzero_ps()));
+			__m128 inv_a = _mm_div_ps(_mm_set1_ps(1.0f), a);
+			__m128 t_near = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(b, root)), inv_a);
+			__m128 t_far = _mm_mul_ps(_mm_sub_ps(root, b), inv_a);
+
+			__m128 use_near = _mm_cmpgt_ps(t_near, t_min);
+			t = _mm_or_ps(_mm_and_ps(use_near, t_near), _mm_andnot_ps(use_near, t_far));
+
+			valid = _mm_and_ps(valid, _mm_cmpgt_ps(t, t_min));
+			valid = _mm_and_ps(valid, _mm_cmplt_ps(t, t_max));
+			return valid;
+		}
+
+		template<size_t W>
+		void load_rays(const ray_packet<W>& rays, const size_t i, sse_vec3& o, sse_vec3& d)
+		{
+			o = { _mm_load_ps(rays.ox + i), _mm_load_ps(rays.oy + i), _mm_load_ps(rays.oz + i) };
+			d = { _mm_load_ps(rays.dx + i), _mm_load_ps(rays.dy + i), _mm_load_ps(rays.dz + i) };
+		}
+
+		// Index of the lowest lane with the smallest t among the lanes in mask
+		inline int nearest_lane(const __m128& t, int mask)
+		{
+			alignas(16) float lanes[4];
+			_mm_store_ps(lanes, t);
+			int best = -1;
+			for (int i = 0; i < 4; i++)
+			{
+				if ((mask >> i) & 1 && (best < 0 || lanes[i] < lanes[best]))
+					best = i;
+			}
+			return best;
+		}
+	}
+
+	/*
+	* Packet kernels, every kernel returns a bit mask with bit i set when ray i hits.
+	* Distances are written for hitting lanes only.
+	*/
+
+	template<size_t W>
+	uint32_t intersect_aabb(const ray_packet<W>& rays, const vec<float, 3>& min, const vec<float, 3>& max, float t[W])
+	{
+		const detail::sse_vec3 bmin = detail::sse_broadcast(min);
+		const detail::sse_vec3 bmax = detail::sse_broadcast(max);
+
+		uint32_t mask{};
+		for (size_t i = 0; i < W; i += 4)
+		{
+			detail::sse_vec3 o{ _mm_load_ps(rays.ox + i), _mm_load_ps(rays.oy + i), _mm_load_ps(rays.oz + i) };
+			detail::sse_vec3 inv_d{ _mm_load_ps(rays.inv_dx + i), _mm_load_ps(rays.inv_dy + i), _mm_load_ps(rays.inv_dz + i) };
+			__m128 t_near = _mm_load_ps(rays.t_min + i);
+			__m128 hit = detail::sse_slab(o, inv_d, bmin, bmax, t_near, _mm_load_ps(rays.t_max + i));
+
+			int lanes = _mm_movemask_ps(hit);
+			if (lanes)
+			{
+				__m128 old = _mm_loadu_ps(t + i);
+				_mm_storeu_ps(t + i, _mm_or_ps(_mm_and_ps(hit, t_near), _mm_andnot_ps(hit, old)));
+			}
+			mask |= static_cast<uint32_t>(lanes) << i;
+		}
+		return mask;
+	}
+
+	template<size_t W>
+	uint32_t intersect_triangle(const ray_packet<W>& rays, const vec<float, 3>& v0, const vec<float, 3>& v1, const vec<float, 3>& v2, hit_packet<W>& hits)
+	{
+		const detail::sse_vec3 p0 = detail::sse_broadcast(v0);
+		const detail::sse_vec3 e1 = detail::sse_broadcast(v1 - v0);
+		const detail::sse_vec3 e2 = detail::sse_broadcast(v2 - v0);
+
+		uint32_t mask{};
+		for (size_t i = 0; i < W; i += 4)
+		{
+			detail::sse_vec3 o, d;
+			detail::load_rays(rays, i, o, d);
+
+			__m128 t, u, v;
+			__m128 hit = detail::sse_triangle(o, d, p0, e1, e2, _mm_load_ps(rays.t_min + i), _mm_load_ps(rays.t_max + i), t, u, v);
+
+			int lanes = _mm_movemask_ps(hit);
+			if (lanes)
+			{
+				_mm_store_ps(hits.t + i, _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, _mm_load_ps(hits.t + i))));
+				_mm_store_ps(hits.u + i, _mm_or_ps(_mm_and_ps(hit, u), _mm_andnot_ps(hit, _mm_load_ps(hits.u + i))));
+				_mm_store_ps(hits.v + i, _mm_or_ps(_mm_and_ps(hit, v), _mm_andnot_ps(hit, _mm_load_ps(hits.v + i))));
+			}
+			mask |= static_cast<uint32_t>(lanes) << i;
+		}
+		return mask;
+	}
+
+	template<size_t W>
+	uint32_t intersect_sphere(const ray_packet<W>& rays, const vec<float, 3>& center, const float& radius, float t[W])
+	{
+		const detail::sse_vec3 c = detail::sse_broadcast(center);
+		const __m128 r2 = _mm_set1_ps(radius * radius);
+
+		uint32_t mask{};
+		for (size_t i = 0; i < W; i += 4)
+		{
+			detail::sse_vec3 o, d;
+			detail::load_rays(rays, i, o, d);
+
+			__m128 t_hit;
+			__m128 hit = detail::sse_sphere(o, d, c, r2, _mm_load_ps(rays.t_min + i), _mm_load_ps(rays.t_max + i), t_hit);
+
+			int lanes = _mm_movemask_ps(hit);
+			if (lanes)
+			{
+				__m128 old = _mm_loadu_ps(t + i);
+				_mm_storeu_ps(t + i, _mm_or_ps(_mm_and_ps(hit, t_hit), _mm_andnot_ps(hit, old)));
+			}
+			mask |= static_cast<uint32_t>(lanes) << i;
+		}
+		return mask;
+	}
+
+	// Shrinks t_max of every hitting lane so following tests only report closer hits
+	template<size_t W>
+	void commit_hits(ray_packet<W>& rays, const uint32_t mask, const float t[W])
+	{
+		for (size_t i = 0; i < W; i++)
+		{
+			if ((mask >> i) & 1)
+				rays.t_max[i] = t[i];
+		}
+	}
+
+	using ray = ray_base<float>;
+	using ray_precise = ray_base<double>;
+	using ray_packet4 = ray_packet<4>;
+	using ray_packet8 = ray_packet<8>;
+	using ray_packet16 = ray_packet<16>;
+
+	/*
+	* Packing of leaf primitives into groups of 4, out has to hold (count + 3) / 4 elements.
+	*/
+
+	inline size_t packed_count(const size_t count)
+	{
+		return (count + 3) / 4;
+	}
+
+	// Padding boxes are a single point at infinity, an inverted box would turn into an infinite slab by the min/max ordering
+	inline void pack_aabbs(const vec3* min, const vec3* max, const size_t count, aabb4* out)
+	{
+		const float inf = std::numeric_limits<float>::infinity();
+		for (size_t i = 0; i < packed_count(count) * 4; i++)
+		{
+			aabb4& block = out[i / 4];
+			size_t lane = i % 4;
+			bool valid = i < count;
+			block.min_x[lane] = valid ? min[i].x : inf;
+			block.min_y[lane] = valid ? min[i].y : inf;
+			block.min_z[lane] = valid ? min[i].z : inf;
+			block.max_x[lane] = valid ? max[i].x : inf;
+			block.max_y[lane] = valid ? max[i].y : inf;
+			block.max_z[lane] = valid ? max[i].z : inf;
+		}
+	}
+
+	// Vertices are consumed as a triangle list, 3 vertices per triangle
+	inline void pack_triangles(const vec3* vertices, const size_t count, triangle4* out)
+	{
+		for (size_t i = 0; i < packed_count(count) * 4; i++)
+		{
+			triangle4& block = out[i / 4];
+			size_t lane = i % 4;
+			// Padding lanes hold a degenerate triangle at the origin, which no ray hits
+			const vec3 zero{ 0.0f, 0.0f, 0.0f };
+			const vec3 v0 = i < count ? vertices[i * 3] : zero;
+			const vec3 e1 = i < count ? vertices[i * 3 + 1] - v0 : zero;
+			const vec3 e2 = i < count ? vertices[i * 3 + 2] - v0 : zero;
+			block.v0_x[lane] = v0.x; block.v0_y[lane] = v0.y; block.v0_z[lane] = v0.z;
+			block.e1_x[lane] = e1.x; block.e1_y[lane] = e1.y; block.e1_z[lane] = e1.z;
+			block.e2_x[lane] = e2.x; block.e2_y[lane] = e2.y; block.e2_z[lane] = e2.z;
+		}
+	}
+
+	inline void pack_spheres(const vec3* centers, const float* radii, const size_t count, sphere4* out)
+	{
+		for (size_t i = 0; i < packed_count(count) * 4; i++)
+		{
+			sphere4& block = out[i / 4];
+			size_t lane = i % 4;
+			bool valid = i < count;
+			block.c_x[lane] = valid ? centers[i].x : 0.0f;
+			block.c_y[lane] = valid ? centers[i].y : 0.0f;
+			block.c_z[lane] = valid ? centers[i].z : 0.0f;
+			block.r2[lane] = valid ? radii[i] * radii[i] : -std::numeric_limits<float>::infinity();
+		}
+	}
+
+	/*
+	* Packing into a new container, pass an arena_allocator to take the blocks from an arena instead of the heap.
+	*/
+
+	template<typename Alloc = std::allocator<aabb4>>
+	std::vector<aabb4, Alloc> pack_aabbs(const vec3* min, const vec3* max, const size_t count, const Alloc& alloc = Alloc())
+	{
+		std::vector<aabb4, Alloc> blocks(packed_count(count), alloc);
+		pack_aabbs(min, max, count, blocks.data());
+		return blocks;
+	}
+
+	template<typename Alloc = std::allocator<triangle4>>
+	std::vector<triangle4, Alloc> pack_triangles(const vec3* vertices, const size_t count, const Alloc& alloc = Alloc())
+	{
+		std::vector<triangle4, Alloc> blocks(packed_count(count), alloc);
+		pack_triangles(vertices, count, blocks.data());
+		return blocks;
+	}
+
+	template<typename Alloc = std::allocator<sphere4>>
+	std::vector<sphere4, Alloc> pack_spheres(const vec3* centers, const float* radii, const size_t count, const Alloc& alloc = Alloc())
+	{
+		std::vector<sphere4, Alloc> blocks(packed_count(count), alloc);
+		pack_spheres(centers, radii, count, blocks.data());
+		return blocks;
+	}
+
+	/*
+	* Single ray against many primitives, meant for the leaves of an acceleration structure.
+	* Returns true when a hit closer than hit.t was found, hit.t should be initialized to the ray's far distance.
+	*/
+
+	inline bool intersect_nearest(const ray& r, const float& t_min, const aabb4* boxes, const size_t block_count, ray_hit& hit)
+	{
+		const detail::sse_vec3 o = detail::sse_broadcast(r.origin);
+		const detail::sse_vec3 inv_d{ _mm_set1_ps(1.0f / r.direction.x), _mm_set1_ps(1.0f / r.direction.y), _mm_set1_ps(1.0f / r.direction.z) };
+		const __m128 near = _mm_set1_ps(t_min);
+
+		bool found{};
+		for (size_t b = 0; b < block_count; b++)
+		{
+			const aabb4& box = boxes[b];
+			detail::sse_vec3 bmin{ _mm_load_ps(box.min_x), _mm_load_ps(box.min_y), _mm_load_ps(box.min_z) };
+			detail::sse_vec3 bmax{ _mm_load_ps(box.max_x), _mm_load_ps(box.max_y), _mm_load_ps(box.max_z) };
+			__m128 t_near = near;
+			__m128 mask = detail::sse_slab(o, inv_d, bmin, bmax, t_near, _mm_set1_ps(hit.t));
+			mask = _mm_and_ps(mask, _mm_cmplt_ps(t_near, _mm_set1_ps(hit.t)));
+
+			int lane = detail::nearest_lane(t_near, _mm_movemask_ps(mask));
+			if (lane >= 0)
+			{
+				alignas(16) float t[4];
+				_mm_store_ps(t, t_near);
+				hit = { t[lane], 0.0f, 0.0f, b * 4 + lane };
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	inline bool intersect_nearest(const ray& r, const float& t_min, const triangle4* triangles, const size_t block_count, ray_hit& hit)
+	{
+		const detail::sse_vec3 o = detail::sse_broadcast(r.origin);
+		const detail::sse_vec3 d = detail::sse_broadcast(r.direction);
+		const __m128 near = _mm_set1_ps(t_min);
+
+		bool found{};
+		for (size_t b = 0; b < block_count; b++)
+		{
+			const triangle4& tri = triangles[b];
+			detail::sse_vec3 v0{ _mm_load_ps(tri.v0_x), _mm_load_ps(tri.v0_y), _mm_load_ps(tri.v0_z) };
+			detail::sse_vec3 e1{ _mm_load_ps(tri.e1_x), _mm_load_ps(tri.e1_y), _mm_load_ps(tri.e1_z) };
+			detail::sse_vec3 e2{ _mm_load_ps(tri.e2_x), _mm_load_ps(tri.e2_y), _mm_load_ps(tri.e2_z) };
+
+			__m128 t, u, v;
+			__m128 mask = detail::sse_triangle(o, d, v0, e1, e2, near, _mm_set1_ps(hit.t), t, u, v);
+
+			int lane = detail::nearest_lane(t, _mm_movemask_ps(mask));
+			if (lane >= 0)
+			{
+				alignas(16) float ts[4], us[4], vs[4];
+				_mm_store_ps(ts, t);
+				_mm_store_ps(us, u);
+				_mm_store_ps(vs, v);
+				hit = { ts[lane], us[lane], vs[lane], b * 4 + lane };
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	inline bool intersect_nearest(const ray& r, const float& t_min, const sphere4* spheres, const size_t block_count, ray_hit& hit)
+	{
+		const detail::sse_vec3 o = detail::sse_broadcast(r.origin);
+		const detail::sse_vec3 d = detail::sse_broadcast(r.direction);
+		const __m128 near = _mm_set1_ps(t_min);
+
+		bool found{};
+		for (size_t b = 0; b < block_count; b++)
+		{
+			const sphere4& sphere = spheres[b];
+			detail::sse_vec3 c{ _mm_load_ps(sphere.c_x), _mm_load_ps(sphere.c_y), _mm_load_ps(sphere.c_z) };
+
+			__m128 t;
+			__m128 mask = detail::sse_sphere(o, d, c, _mm_load_ps(sphere.r2), near, _mm_set1_ps(hit.t), t);
+
+			int lane = detail::nearest_lane(t, _mm_movemask_ps(mask));
+			if (lane >= 0)
+			{
+				alignas(16) float ts[4];
+				_mm_store_ps(ts, t);
+				hit = { ts[lane], 0.0f, 0.0f, b * 4 + lane };
+				found = true;
+			}
+		}
+		return found;
+	}
+}
\ No newline at end of file
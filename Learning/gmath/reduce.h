@@ -0,0 +1,377 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "gmath.h"
+#include "vec.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace gmath
+{
+	/*
+	* Reductions over spans of vector<T, N>: bounds, sum, centroid, covariance and principal axes.
+	* Points are transposed a register at a time so every lane reduces its own points, the lanes are folded at the end
+	* of a chunk and the chunks of parallel_for are merged pairwise. Sums and products are accumulated in doubles.
+	*/
+
+	template<typename T, size_t N>
+	struct aabb
+	{
+		vector<T, N> min;
+		vector<T, N> max;
+	};
+
+	template<typename T, size_t N>
+	struct principal_axes
+	{
+		vector<T, N> centroid;
+		// Variance along every axis, largest first
+		vector<T, N> variances;
+		// Row i is the unit axis of variances[i]
+		matrix<T, N, N> axes;
+	};
+
+	namespace detail
+	{
+		// Loads n <= W points into one register per component, lanes past n get fill
+		template<size_t W, typename U, typename T, size_t N>
+		void load_components(const vector<T, N>* points, size_t n, const vector<T, N>& fill, simd<U, W>* out)
+		{
+			U values[N][W];
+			for (size_t l = 0; l < W; l++)
+			{
+				const vector<T, N>& p = l < n ? points[l] : fill;
+				for (size_t d = 0; d < N; d++)
+					values[d][l] = static_cast<U>(p[d]);
+			}
+			for (size_t d = 0; d < N; d++)
+				out[d] = simd<U, W>::load(values[d]);
+		}
+
+		// Runs accumulate(state, first, last) per parallel_for chunk and merges the chunk states as a binary tree
+		template<typename State, typename F, typename Merge>
+		State reduce_chunks(size_t count, const State& init, F accumulate, Merge merge)
+		{
+			if (count == 0)
+				return init;
+
+			size_t grain = get_parallel_config().batch_grain;
+			std::vector<State> partial(parallel_chunk_count(count, grain), init);
+			parallel_for(count, grain, [&](size_t chunk, size_t first, size_t last)
+			{
+				accumulate(partial[chunk], first, last);
+			});
+
+			for (size_t step = 1; step < partial.size(); step *= 2)
+			{
+				for (size_t i = 0; i + step < partial.size(); i += 2 * step)
+					merge(partial[i], partial[i + step]);
+			}
+			return partial[0];
+		}
+
+		// Sums of p - pivot and of their pairwise products, the pivot keeps the products small for far away clouds
+		template<size_t N>
+		struct moments
+		{
+			double sum[N]{};
+			double products[N][N]{};
+			uint64_t count{};
+		};
+
+		template<typename T, size_t N>
+		moments<N> accumulate_moments(const vector<T, N>* points, size_t count, const vector<T, N>& pivot, bool products)
+		{
+			constexpr size_t lanes = simd_native_width<double>();
+			using V = simd<double, lanes>;
+
+			auto accumulate = [&](moments<N>& m, size_t first, size_t last)
+			{
+				V origin[N], sum[N], product[N][N];
+				for (size_t d = 0; d < N; d++)
+				{
+					origin[d] = V(static_cast<double>(pivot[d]));
+					sum[d] = V(0.0);
+					for (size_t e = d; e < N; e++)
+						product[d][e] = V(0.0);
+				}
+
+				// Padding lanes hold the pivot, which adds nothing to either sum
+				for (size_t i = first; i < last; i += lanes)
+				{
+					V p[N];
+					load_components<lanes, double>(points + i, std::min(lanes, last - i), pivot, p);
+					for (size_t d = 0; d < N; d++)
+					{
+						p[d] -= origin[d];
+						sum[d] += p[d];
+					}
+					if (!products)
+						continue;
+					for (size_t d = 0; d < N; d++)
+					{
+						for (size_t e = d; e < N; e++)
+							product[d][e] = fma(p[d], p[e], product[d][e]);
+					}
+				}
+
+				for (size_t d = 0; d < N; d++)
+				{
+					m.sum[d] += reduce_add(sum[d]);
+					for (size_t e = d; e < N; e++)
+						m.products[d][e] += reduce_add(product[d][e]);
+				}
+				m.count += last - first;
+			};
+
+			auto merge = [](moments<N>& a, const moments<N>& b)
+			{
+				for (size_t d = 0; d < N; d++)
+				{
+					a.sum[d] += b.sum[d];
+					for (size_t e = d; e < N; e++)
+						a.products[d][e] += b.products[d][e];
+				}
+				a.count += b.count;
+			};
+
+			return reduce_chunks(count, moments<N>{}, accumulate, merge);
+		}
+
+		// Covariance about the mean from moments taken about any pivot
+		template<size_t N>
+		void covariance_of(const moments<N>& m, double out[N][N])
+		{
+			double n = static_cast<double>(std::max<uint64_t>(1, m.count));
+			for (size_t d = 0; d < N; d++)
+			{
+				for (size_t e = d; e < N; e++)
+				{
+					out[d][e] = m.products[d][e] / n - (m.sum[d] / n) * (m.sum[e] / n);
+					out[e][d] = out[d][e];
+				}
+			}
+		}
+
+		/*
+		* Cyclic Jacobi rotations on a symmetric matrix. On return the diagonal of a holds the eigenvalues and column i
+		* of v the eigenvector of a[i][i].
+		*/
+		template<size_t N>
+		void symmetric_eigen(double a[N][N], double v[N][N])
+		{
+			for (size_t i = 0; i < N; i++)
+			{
+				for (size_t j = 0; j < N; j++)
+					v[i][j] = i == j ? 1.0 : 0.0;
+			}
+
+			for (size_t sweep = 0; sweep < 32; sweep++)
+			{
+				double off = 0.0, diagonal = 0.0;
+				for (size_t p = 0; p < N; p++)
+				{
+					diagonal += a[p][p] * a[p][p];
+					for (size_t q = p + 1; q < N; q++)
+						off += a[p][q] * a[p][q];
+				}
+				if (off <= 1e-30 * diagonal || off == 0.0)
+					return;
+
+				for (size_t p = 0; p < N; p++)
+				{
+					for (size_t q = p + 1; q < N; q++)
+					{
+						if (a[p][q] == 0.0)
+							continue;
+
+						double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+						double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+						double c = 1.0 / std::sqrt(t * t + 1.0);
+						double s = t * c;
+						for (size_t k = 0; k < N; k++)
+						{
+							double kp = a[k][p], kq = a[k][q];
+							a[k][p] = c * kp - s * kq;
+							a[k][q] = s * kp + c * kq;
+						}
+						for (size_t k = 0; k < N; k++)
+						{
+							double pk = a[p][k], qk = a[q][k];
+							a[p][k] = c * pk - s * qk;
+							a[q][k] = s * pk + c * qk;
+						}
+						for (size_t k = 0; k < N; k++)
+						{
+							double kp = v[k][p], kq = v[k][q];
+							v[k][p] = c * kp - s * kq;
+							v[k][q] = s * kp + c * kq;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Component-wise bounds, an empty span gives min at the largest and max at the lowest value of T
+	template<typename T, size_t N>
+	aabb<T, N> bounds(const vector<T, N>* points, size_t count)
+	{
+		constexpr size_t lanes = simd_native_width<T>();
+		using V = simd<T, lanes>;
+
+		aabb<T, N> init;
+		for (size_t d = 0; d < N; d++)
+		{
+			init.min[d] = std::numeric_limits<T>::max();
+			init.max[d] = std::numeric_limits<T>::lowest();
+		}
+
+		auto accumulate = [&](aabb<T, N>& box, size_t first, size_t last)
+		{
+			V low[N], high[N];
+			for (size_t d = 0; d < N; d++)
+			{
+				low[d] = V(box.min[d]);
+				high[d] = V(box.max[d]);
+			}
+			// Padding lanes repeat the first point of the register, which is in the box anyway
+			for (size_t i = first; i < last; i += lanes)
+			{
+				V p[N];
+				detail::load_components<lanes, T>(points + i, std::min(lanes, last - i), points[i], p);
+				for (size_t d = 0; d < N; d++)
+				{
+					low[d] = min(low[d], p[d]);
+					high[d] = max(high[d], p[d]);
+				}
+			}
+			for (size_t d = 0; d < N; d++)
+			{
+				box.min[d] = reduce_min(low[d]);
+				box.max[d] = reduce_max(high[d]);
+			}
+		};
+
+		auto merge = [](aabb<T, N>& a, const aabb<T, N>& b)
+		{
+			for (size_t d = 0; d < N; d++)
+			{
+				a.min[d] = std::min(a.min[d], b.min[d]);
+				a.max[d] = std::max(a.max[d], b.max[d]);
+			}
+		};
+
+		return detail::reduce_chunks(count, init, accumulate, merge);
+	}
+
+	template<typename T, size_t N>
+	vector<T, N> sum(const vector<T, N>* points, size_t count)
+	{
+		detail::moments<N> m = detail::accumulate_moments(points, count, vector<T, N>{}, false);
+		vector<T, N> result{};
+		for (size_t d = 0; d < N; d++)
+			result[d] = static_cast<T>(m.sum[d]);
+		return result;
+	}
+
+	// Mean point, zero for an empty span
+	template<typename T, size_t N>
+	vector<T, N> centroid(const vector<T, N>* points, size_t count)
+	{
+		vector<T, N> result{};
+		if (count == 0)
+			return result;
+
+		detail::moments<N> m = detail::accumulate_moments(points, count, points[0], false);
+		for (size_t d = 0; d < N; d++)
+			result[d] = static_cast<T>(static_cast<double>(points[0][d]) + m.sum[d] / static_cast<double>(count));
+		return result;
+	}
+
+	// Population covariance, divided by the point count, in one pass over the points
+	template<typename T, size_t N>
+	matrix<T, N, N> covariance(const vector<T, N>* points, size_t count)
+	{
+		matrix<T, N, N> result{};
+		if (count == 0)
+			return result;
+
+		double c[N][N];
+		detail::covariance_of(detail::accumulate_moments(points, count, points[0], true), c);
+		for (size_t d = 0; d < N; d++)
+		{
+			for (size_t e = 0; e < N; e++)
+				result.rows[d][e] = static_cast<T>(c[d][e]);
+		}
+		return result;
+	}
+
+	// Centroid and eigen decomposition of the covariance, also from a single pass over the points
+	template<typename T, size_t N>
+	principal_axes<T, N> principal_components(const vector<T, N>* points, size_t count)
+	{
+		principal_axes<T, N> result{};
+		if (count == 0)
+			return result;
+
+		detail::moments<N> m = detail::accumulate_moments(points, count, points[0], true);
+		double a[N][N], v[N][N];
+		detail::covariance_of(m, a);
+		detail::symmetric_eigen<N>(a, v);
+
+		size_t order[N];
+		for (size_t d = 0; d < N; d++)
+			order[d] = d;
+		std::sort(order, order + N, [&a](size_t i, size_t j) { return a[i][i] > a[j][j]; });
+
+		for (size_t d = 0; d < N; d++)
+		{
+			result.centroid[d] = static_cast<T>(static_cast<double>(points[0][d]) + m.sum[d] / static_cast<double>(count));
+			result.variances[d] = static_cast<T>(std::max(0.0, a[order[d]][order[d]]));
+			for (size_t e = 0; e < N; e++)
+				result.axes.rows[d][e] = static_cast<T>(v[e][order[d]]);
+		}
+		return result;
+	}
+
+	/*
+	* std::vector overloads
+	*/
+
+	template<typename T, size_t N>
+	aabb<T, N> bounds(const std::vector<vector<T, N>>& points)
+	{
+		return bounds(points.data(), points.size());
+	}
+
+	template<typename T, size_t N>
+	vector<T, N> sum(const std::vector<vector<T, N>>& points)
+	{
+		return sum(points.data(), points.size());
+	}
+
+	template<typename T, size_t N>
+	vector<T, N> centroid(const std::vector<vector<T, N>>& points)
+	{
+		return centroid(points.data(), points.size());
+	}
+
+	template<typename T, size_t N>
+	matrix<T, N, N> covariance(const std::vector<vector<T, N>>& points)
+	{
+		return covariance(points.data(), points.size());
+	}
+
+	template<typename T, size_t N>
+	principal_axes<T, N> principal_components(const std::vector<vector<T, N>>& points)
+	{
+		return principal_components(points.data(), points.size());
+	}
+}
\ No newline at end of file
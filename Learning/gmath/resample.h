@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "gmath.h"
+#include "color.h"
+#include "image.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace gmath
+{
+	/*
+	* Mip chains and arbitrary resampling of color_base images.
+	* A gamma other than 1 makes both gamma aware: the colour channels are averaged as value^gamma and stored back as
+	* linear^(1 / gamma), so dark and bright halves of an edge blend to the right brightness. Alpha is always linear.
+	*/
+
+	enum class resample_filter
+	{
+		// Triangle over 2 pixels
+		bilinear,
+		// Catmull-Rom over 4 pixels, sharper but may ring slightly
+		bicubic,
+		// Lanczos with 3 lobes over 6 pixels
+		lanczos
+	};
+
+	struct resample_options
+	{
+		resample_filter filter{ resample_filter::bilinear };
+		float gamma{ 1.0f };
+	};
+
+	namespace detail
+	{
+		constexpr size_t gamma_encode_size = 4096;
+
+		/*
+		* Pixel values to floats in [0, 1] and back. Decoding is a lookup for 8 and 16 bit values, encoding looks up
+		* the square root of the value so the steep start of the curve gets most of the entries.
+		*/
+		template<typename T>
+		class gamma_tables
+		{
+		public:
+			explicit gamma_tables(float gamma)
+				: gamma(gamma), linear(gamma == 1.0f)
+			{
+				if (linear)
+					return;
+
+				if constexpr (sizeof(T) <= 2)
+				{
+					decode_table.resize(static_cast<size_t>(std::numeric_limits<T>::max()) + 1);
+					for (size_t v = 0; v < decode_table.size(); v++)
+						decode_table[v] = std::pow(static_cast<float>(v) * inverse_max, gamma);
+				}
+				encode_table.resize(gamma_encode_size + 1);
+				for (size_t i = 0; i <= gamma_encode_size; i++)
+				{
+					float s = static_cast<float>(i) / gamma_encode_size;
+					encode_table[i] = std::pow(s * s, 1.0f / gamma) * max_value;
+				}
+			}
+
+			bool is_linear() const
+			{
+				return linear;
+			}
+
+			float decode(T v) const
+			{
+				if (linear)
+					return static_cast<float>(v) * inverse_max;
+				if constexpr (sizeof(T) <= 2)
+					return decode_table[v];
+				else
+					return std::pow(static_cast<float>(v) * inverse_max, gamma);
+			}
+
+			float decode_alpha(T v) const
+			{
+				return static_cast<float>(v) * inverse_max;
+			}
+
+			T encode(float x) const
+			{
+				x = std::clamp(x, 0.0f, 1.0f);
+				if (linear)
+					return channel_cast<T>(x * max_double + 0.5);
+
+				float s = std::sqrt(x) * gamma_encode_size;
+				size_t i = std::min(static_cast<size_t>(s), gamma_encode_size - 1);
+				float value = encode_table[i] + (encode_table[i + 1] - encode_table[i]) * (s - static_cast<float>(i));
+				return channel_cast<T>(value + 0.5);
+			}
+
+			T encode_alpha(float x) const
+			{
+				return channel_cast<T>(std::clamp(x, 0.0f, 1.0f) * max_double + 0.5);
+			}
+
+		private:
+			static constexpr float max_value = static_cast<float>(std::numeric_limits<T>::max());
+			static constexpr double max_double = static_cast<double>(std::numeric_limits<T>::max());
+			static constexpr float inverse_max = 1.0f / max_value;
+
+			float gamma;
+			bool linear;
+			std::vector<float> decode_table;
+			std::vector<float> encode_table;
+		};
+
+		// Rounded mean of four channel values, 64 bit channels divide first so the sum cannot overflow
+		template<typename T>
+		T mean4(T a, T b, T c, T d)
+		{
+			if constexpr (sizeof(T) <= 4)
+			{
+				using sum_type = std::conditional_t<sizeof(T) <= 2, uint32_t, uint64_t>;
+				return static_cast<T>((sum_type(a) + sum_type(b) + sum_type(c) + sum_type(d) + 2) / 4);
+			}
+			else
+				return a / 4 + b / 4 + c / 4 + d / 4 + (a % 4 + b % 4 + c % 4 + d % 4 + 2) / 4;
+		}
+
+		// One mip level: every destination pixel averages a 2x2 block, the last row and column repeat on odd sizes
+		template<typename T>
+		void downsample(const image_view<const color_base<T>>& src, const image_view<color_base<T>>& dst, const gamma_tables<T>& tables)
+		{
+			size_t grain = std::max<size_t>(1, get_parallel_config().batch_grain / std::max<size_t>(1, dst.width));
+
+			parallel_for(dst.height, grain, [&](size_t first, size_t last)
+			{
+				for (size_t y = first; y < last; y++)
+				{
+					const color_base<T>* r0 = src.row(std::min(2 * y, src.height - 1));
+					const color_base<T>* r1 = src.row(std::min(2 * y + 1, src.height - 1));
+					color_base<T>* out = dst.row(y);
+					for (size_t x = 0; x < dst.width; x++)
+					{
+						size_t x0 = std::min(2 * x, src.width - 1);
+						size_t x1 = std::min(2 * x + 1, src.width - 1);
+						if (tables.is_linear())
+						{
+							// Rounded integer mean, the loop over the channels vectorizes
+							for (size_t c = 0; c < 4; c++)
+								out[x][c] = mean4<T>(r0[x0][c], r0[x1][c], r1[x0][c], r1[x1][c]);
+							continue;
+						}
+
+						for (size_t c = 0; c < 3; c++)
+						{
+							float sum = tables.decode(r0[x0][c]) + tables.decode(r0[x1][c]) + tables.decode(r1[x0][c]) + tables.decode(r1[x1][c]);
+							out[x][c] = tables.encode(sum * 0.25f);
+						}
+						out[x].a = mean4<T>(r0[x0].a, r0[x1].a, r1[x0].a, r1[x1].a);
+					}
+				}
+			});
+		}
+
+		inline double filter_radius(resample_filter filter)
+		{
+			switch (filter)
+			{
+			case resample_filter::bicubic:
+				return 2.0;
+			case resample_filter::lanczos:
+				return 3.0;
+			default:
+				return 1.0;
+			}
+		}
+
+		inline double filter_weight(resample_filter filter, double x)
+		{
+			x = std::abs(x);
+			switch (filter)
+			{
+			case resample_filter::bicubic:
+				if (x < 1.0)
+					return 1.5 * x * x * x - 2.5 * x * x + 1.0;
+				if (x < 2.0)
+					return -0.5 * x * x * x + 2.5 * x * x - 4.0 * x + 2.0;
+				return 0.0;
+			case resample_filter::lanczos:
+				if (x == 0.0)
+					return 1.0;
+				if (x < 3.0)
+				{
+					double px = PI * x;
+					return 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px);
+				}
+				return 0.0;
+			default:
+				return std::max(0.0, 1.0 - x);
+			}
+		}
+
+		// Source pixel and weight of every tap of every destination pixel along one axis, taps past the edge repeat it
+		struct resample_axis
+		{
+			size_t taps{};
+			std::vector<uint32_t> indices;
+			std::vector<float> weights;
+		};
+
+		inline resample_axis make_axis(size_t src, size_t dst, resample_filter filter)
+		{
+			// Shrinking widens the filter by the ratio so every source pixel contributes
+			double ratio = static_cast<double>(src) / static_cast<double>(dst);
+			double scale = std::max(1.0, ratio);
+			double support = filter_radius(filter) * scale;
+
+			resample_axis axis;
+			axis.taps = static_cast<size_t>(std::ceil(support * 2.0)) + 1;
+			axis.indices.resize(dst * axis.taps);
+			axis.weights.resize(dst * axis.taps);
+			for (size_t i = 0; i < dst; i++)
+			{
+				double center = (static_cast<double>(i) + 0.5) * ratio - 0.5;
+				double first = std::floor(center - support) + 1.0;
+				double sum = 0.0;
+				for (size_t k = 0; k < axis.taps; k++)
+				{
+					double position = first + static_cast<double>(k);
+					double w = filter_weight(filter, (position - center) / scale);
+					axis.indices[i * axis.taps + k] = static_cast<uint32_t>(std::clamp(position, 0.0, static_cast<double>(src - 1)));
+					axis.weights[i * axis.taps + k] = static_cast<float>(w);
+					sum += w;
+				}
+				for (size_t k = 0; k < axis.taps; k++)
+					axis.weights[i * axis.taps + k] = static_cast<float>(axis.weights[i * axis.taps + k] / sum);
+			}
+			return axis;
+		}
+	}
+
+	// Levels of a full mip chain including level 0, the last level is 1x1
+	inline size_t mip_level_count(size_t width, size_t height)
+	{
+		size_t levels = 1;
+		for (size_t size = std::max(width, height); size > 1; size /= 2)
+			levels++;
+		return levels;
+	}
+
+	/*
+	* Streams the mip levels below src to emit(level, view), level 1 is half the size of src and every level halves
+	* again down to 1x1, rounding down. Only two levels are alive at a time and the view is reused after emit returns.
+	*/
+	template<typename T, typename F>
+	void for_each_mip(const image_view<const color_base<T>>& src, float gamma, F emit)
+	{
+		static_assert(std::is_integral_v<T>, "mip chains are built for integer colour types such as color and color16");
+		if (src.width == 0 || src.height == 0)
+			return;
+
+		detail::gamma_tables<T> tables(gamma);
+		image<color_base<T>> levels[2];
+		image_view<const color_base<T>> previous = src;
+		for (size_t level = 1; previous.width > 1 || previous.height > 1; level++)
+		{
+			image<color_base<T>>& next = levels[level % 2];
+			next.resize(std::max<size_t>(1, previous.width / 2), std::max<size_t>(1, previous.height / 2));
+			detail::downsample(previous, next.view(), tables);
+			emit(level, image_view<const color_base<T>>(next.view()));
+			previous = next.view();
+		}
+	}
+
+	template<typename T, typename F>
+	void for_each_mip(const image<color_base<T>>& src, float gamma, F emit)
+	{
+		for_each_mip(src.view(), gamma, emit);
+	}
+
+	// Every level below src, element i is level i + 1
+	template<typename T>
+	std::vector<image<color_base<T>>> mip_chain(const image_view<const color_base<T>>& src, float gamma = 1.0f)
+	{
+		std::vector<image<color_base<T>>> chain;
+		chain.reserve(mip_level_count(src.width, src.height) - 1);
+		for_each_mip(src, gamma, [&chain](size_t, const image_view<const color_base<T>>& level)
+		{
+			image<color_base<T>> copy(level.width, level.height);
+			std::copy(level.data, level.data + level.size(), copy.data());
+			chain.push_back(std::move(copy));
+		});
+		return chain;
+	}
+
+	template<typename T>
+	std::vector<image<color_base<T>>> mip_chain(const image<color_base<T>>& src, float gamma = 1.0f)
+	{
+		return mip_chain(src.view(), gamma);
+	}
+
+	/*
+	* Resizes src to the size of dst. Rows are filtered first into a float buffer of dst.width x src.height,
+	* four channels per register, then every destination row sums its taps over whole buffer rows a full register
+	* at a time. Both passes run in parallel. All of src is read before dst is written.
+	*/
+	template<typename T>
+	void resample(const std::type_identity_t<image_view<const color_base<T>>>& src, const image_view<color_base<T>>& dst, const resample_options& options = {})
+	{
+		static_assert(std::is_integral_v<T>, "resample writes integer colour types such as color and color16");
+		if (src.width == 0 || src.height == 0 || dst.width == 0 || dst.height == 0)
+			return;
+
+		constexpr size_t lanes = simd_native_width<float>();
+		using V = simd<float, lanes>;
+		using pixel_type = simd<float, 4>;
+
+		detail::gamma_tables<T> tables(options.gamma);
+		detail::resample_axis horizontal = detail::make_axis(src.width, dst.width, options.filter);
+		detail::resample_axis vertical = detail::make_axis(src.height, dst.height, options.filter);
+
+		// Rows are rounded up to a register so the vertical pass never needs a scalar tail
+		size_t stride = (dst.width * 4 + lanes - 1) / lanes * lanes;
+		std::unique_ptr<float[]> rows(new float[stride * src.height]);
+
+		size_t grain = std::max<size_t>(1, get_parallel_config().batch_grain / std::max<size_t>(1, src.width));
+		parallel_for(src.height, grain, [&](size_t first, size_t last)
+		{
+			std::vector<float> decoded(src.width * 4);
+			for (size_t y = first; y < last; y++)
+			{
+				const color_base<T>* in = src.row(y);
+				for (size_t x = 0; x < src.width; x++)
+				{
+					for (size_t c = 0; c < 3; c++)
+						decoded[x * 4 + c] = tables.decode(in[x][c]);
+					decoded[x * 4 + 3] = tables.decode_alpha(in[x].a);
+				}
+
+				float* out = rows.get() + y * stride;
+				for (size_t x = 0; x < dst.width; x++)
+				{
+					const uint32_t* index = horizontal.indices.data() + x * horizontal.taps;
+					const float* weight = horizontal.weights.data() + x * horizontal.taps;
+					pixel_type sum(0.0f);
+					for (size_t k = 0; k < horizontal.taps; k++)
+						sum = fma(pixel_type::load(decoded.data() + index[k] * 4), pixel_type(weight[k]), sum);
+					sum.store(out + x * 4);
+				}
+				std::fill(out + dst.width * 4, out + stride, 0.0f);
+			}
+		});
+
+		grain = std::max<size_t>(1, get_parallel_config().batch_grain / dst.width);
+		parallel_for(dst.height, grain, [&](size_t first, size_t last)
+		{
+			std::vector<float> filtered(stride);
+			for (size_t y = first; y < last; y++)
+			{
+				const uint32_t* index = vertical.indices.data() + y * vertical.taps;
+				const float* weight = vertical.weights.data() + y * vertical.taps;
+				for (size_t i = 0; i < stride; i += lanes)
+				{
+					V sum(0.0f);
+					for (size_t k = 0; k < vertical.taps; k++)
+						sum = fma(V::load(rows.get() + index[k] * stride + i), V(weight[k]), sum);
+					sum.store(filtered.data() + i);
+				}
+
+				color_base<T>* out = dst.row(y);
+				for (size_t x = 0; x < dst.width; x++)
+				{
+					for (size_t c = 0; c < 3; c++)
+						out[x][c] = tables.encode(filtered[x * 4 + c]);
+					out[x].a = tables.encode_alpha(filtered[x * 4 + 3]);
+				}
+			}
+		});
+	}
+}
\ No newline at end of file
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <limits>
+#include <system_error>
+#include <type_traits>
+
+#include "vec.h"
+#include "matrix.h"
+#include "color.h"
+
+namespace gmath
+{
+	/*
+	* Allocation free text serialization on top of std::to_chars and std::from_chars.
+	* Elements are written as their scalars separated by single spaces, matrices in row-major order and colors as rgba integers.
+	* Arrays put one element per line. Floating point values use the shortest representation that round-trips exactly.
+	*/
+
+	namespace detail
+	{
+		template<typename T>
+		constexpr size_t max_scalar_chars()
+		{
+			if constexpr (std::is_floating_point_v<T>)
+				return 4 + std::numeric_limits<T>::max_digits10 + 6; // sign, point, exponent
+			else
+				return 2 + std::numeric_limits<T>::digits10 + 1;
+		}
+
+		template<typename T>
+		std::to_chars_result write_scalars(char* first, char* last, const T* values, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				if (i > 0)
+				{
+					if (first == last)
+						return { last, std::errc::value_too_large };
+					*first++ = ' ';
+				}
+
+				std::to_chars_result result{};
+				if constexpr (sizeof(T) == 1)
+					result = std::to_chars(first, last, static_cast<int>(values[i]));
+				else
+					result = std::to_chars(first, last, values[i]);
+				if (result.ec != std::errc{})
+					return result;
+				first = result.ptr;
+			}
+			return { first, std::errc{} };
+		}
+
+		inline const char* skip_whitespace(const char* first, const char* last)
+		{
+			while (first != last && (*first == ' ' || *first == '\t' || *first == '\n' || *first == '\r' || *first == ','))
+				first++;
+			return first;
+		}
+
+		template<typename T>
+		std::from_chars_result read_scalars(const char* first, const char* last, T* values, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				first = skip_whitespace(first, last);
+				std::from_chars_result result{};
+				if constexpr (sizeof(T) == 1)
+				{
+					int value{};
+					result = std::from_chars(first, last, value);
+					if (result.ec == std::errc{} && (value < std::numeric_limits<T>::min() || value > std::numeric_limits<T>::max()))
+						result.ec = std::errc::result_out_of_range;
+					values[i] = static_cast<T>(value);
+				}
+				else
+				{
+					result = std::from_chars(first, last, values[i]);
+				}
+				if (result.ec != std::errc{})
+					return result;
+				first = result.ptr;
+			}
+			return { first, std::errc{} };
+		}
+
+		template<typename Elem>
+		struct text_layout;
+
+		template<typename T, size_t N>
+		struct text_layout<vector<T, N>>
+		{
+			using scalar = T;
+			static constexpr size_t count = N;
+			static const T* begin(const vector<T, N>& v) { return v.data; }
+			static T* begin(vector<T, N>& v) { return v.data; }
+		};
+
+		template<typename T, size_t N, size_t M>
+		struct text_layout<matrix<T, N, M>>
+		{
+			using scalar = T;
+			static constexpr size_t count = N * M;
+			static const T* begin(const matrix<T, N, M>& m) { return m.elements; }
+			static T* begin(matrix<T, N, M>& m) { return m.elements; }
+		};
+
+		template<typename T>
+		struct text_layout<color_base<T>>
+		{
+			using scalar = T;
+			static constexpr size_t count = 4;
+			static const T* begin(const color_base<T>& c) { return c.data; }
+			static T* begin(color_base<T>& c) { return c.data; }
+		};
+	}
+
+	// Upper bound of the characters to_chars writes for one element, including the line break of arrays
+	template<typename Elem>
+	constexpr size_t max_chars()
+	{
+		using layout = detail::text_layout<Elem>;
+		return layout::count * (detail::max_scalar_chars<typename layout::scalar>() + 1);
+	}
+
+	template<typename T, size_t N>
+	std::to_chars_result to_chars(char* first, char* last, const vector<T, N>& v)
+	{
+		return detail::write_scalars(first, last, v.data, N);
+	}
+
+	template<typename T, size_t N, size_t M>
+	std::to_chars_result to_chars(char* first, char* last, const matrix<T, N, M>& m)
+	{
+		return detail::write_scalars(first, last, m.elements, N * M);
+	}
+
+	template<typename T>
+	std::to_chars_result to_chars(char* first, char* last, const color_base<T>& c)
+	{
+		return detail::write_scalars(first, last, c.data, 4);
+	}
+
+	// Writes one element per line, on failure ptr == last and nothing after the last complete line is valid
+	template<typename Elem>
+	std::to_chars_result to_chars(char* first, char* last, const Elem* elements, size_t count)
+	{
+		using layout = detail::text_layout<Elem>;
+		for (size_t i = 0; i < count; i++)
+		{
+			std::to_chars_result result = detail::write_scalars(first, last, layout::begin(elements[i]), layout::count);
+			if (result.ec != std::errc{} || result.ptr == last)
+				return { last, std::errc::value_too_large };
+			first = result.ptr;
+			*first++ = '\n';
+		}
+		return { first, std::errc{} };
+	}
+
+	/*
+	* Parsing accepts any mix of spaces, tabs, commas and line breaks between scalars.
+	*/
+
+	template<typename T, size_t N>
+	std::from_chars_result from_chars(const char* first, const char* last, vector<T, N>& v)
+	{
+		return detail::read_scalars(first, last, v.data, N);
+	}
+
+	template<typename T, size_t N, size_t M>
+	std::from_chars_result from_chars(const char* first, const char* last, matrix<T, N, M>& m)
+	{
+		return detail::read_scalars(first, last, m.elements, N * M);
+	}
+
+	template<typename T>
+	std::from_chars_result from_chars(const char* first, const char* last, color_base<T>& c)
+	{
+		return detail::read_scalars(first, last, c.data, 4);
+	}
+
+	// Parses up to capacity elements, count receives the number of elements that were read completely
+	template<typename Elem>
+	std::from_chars_result from_chars(const char* first, const char* last, Elem* elements, size_t capacity, size_t& count)
+	{
+		using layout = detail::text_layout<Elem>;
+		count = 0;
+		while (count < capacity && detail::skip_whitespace(first, last) != last)
+		{
+			std::from_chars_result result = detail::read_scalars(first, last, layout::begin(elements[count]), layout::count);
+			if (result.ec != std::errc{})
+				return result;
+			first = result.ptr;
+			count++;
+		}
+		return { detail::skip_whitespace(first, last), std::errc{} };
+	}
+}
\ No newline at end of file
@@ -0,0 +1,581 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GMATH_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#define GMATH_SIMD_AVX
+#include <immintrin.h>
+#endif
+
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define GMATH_SIMD_FMA
+#endif
+
+#if defined(__AVX512F__)
+#define GMATH_SIMD_AVX512
+#endif
+
+namespace gmath
+{
+	/*
+	* Portable SIMD register of W lanes of T.
+	* simd<float, 4> and simd<double, 2> map to SSE2, the 256 bit widths to AVX (with FMA when the compiler targets it)
+	* and the 512 bit widths to AVX-512F. Every other combination, and every width on a toolchain without these ISAs,
+	* uses the scalar backend, so code written against simd compiles everywhere and only the speed changes.
+	* Comparisons return a simd_mask that feeds select, any and all. rsqrt and rcp are the hardware estimates
+	* (12 bits for SSE and AVX, 14 bits for AVX-512), the scalar backend and double lanes compute them exactly.
+	*/
+
+	template<typename T, size_t W>
+	struct simd;
+
+	template<typename T, size_t W>
+	struct simd_mask;
+
+	// Lane access and compound assignment shared by every backend
+	template<typename T, size_t W, typename S>
+	struct simd_base
+	{
+		using value_type = T;
+		static constexpr size_t width = W;
+
+		T operator[](const size_t i) const
+		{
+			T lanes[W];
+			static_cast<const S&>(*this).store(lanes);
+			return lanes[i];
+		}
+
+		S& operator+=(const S& b) { return static_cast<S&>(*this) = static_cast<S&>(*this) + b; }
+		S& operator-=(const S& b) { return static_cast<S&>(*this) = static_cast<S&>(*this) - b; }
+		S& operator*=(const S& b) { return static_cast<S&>(*this) = static_cast<S&>(*this) * b; }
+		S& operator/=(const S& b) { return static_cast<S&>(*this) = static_cast<S&>(*this) / b; }
+	};
+
+	/*
+	* Scalar backend
+	*/
+
+	template<typename T, size_t W>
+	struct simd_mask
+	{
+		bool lanes[W]{};
+
+		bool any() const { return std::any_of(lanes, lanes + W, [](bool b) { return b; }); }
+		bool all() const { return std::all_of(lanes, lanes + W, [](bool b) { return b; }); }
+
+		friend simd_mask operator&(const simd_mask& a, const simd_mask& b)
+		{
+			simd_mask r;
+			for (size_t i = 0; i < W; i++)
+				r.lanes[i] = a.lanes[i] && b.lanes[i];
+			return r;
+		}
+
+		friend simd_mask operator|(const simd_mask& a, const simd_mask& b)
+		{
+			simd_mask r;
+			for (size_t i = 0; i < W; i++)
+				r.lanes[i] = a.lanes[i] || b.lanes[i];
+			return r;
+		}
+
+		friend simd_mask operator!(const simd_mask& a)
+		{
+			simd_mask r;
+			for (size_t i = 0; i < W; i++)
+				r.lanes[i] = !a.lanes[i];
+			return r;
+		}
+	};
+
+	template<typename T, size_t W>
+	struct simd : simd_base<T, W, simd<T, W>>
+	{
+		using mask = simd_mask<T, W>;
+
+		T v[W];
+
+		simd() = default;
+		simd(const T& s) { std::fill(v, v + W, s); }
+
+		static simd load(const T* p) { simd r; std::copy(p, p + W, r.v); return r; }
+		void store(T* p) const { std::copy(v, v + W, p); }
+
+		template<typename F>
+		static simd apply(const simd& a, const simd& b, F f)
+		{
+			simd r;
+			for (size_t i = 0; i < W; i++)
+				r.v[i] = f(a.v[i], b.v[i]);
+			return r;
+		}
+
+		template<typename F>
+		static mask compare(const simd& a, const simd& b, F f)
+		{
+			mask r;
+			for (size_t i = 0; i < W; i++)
+				r.lanes[i] = f(a.v[i], b.v[i]);
+			return r;
+		}
+
+		friend simd operator+(const simd& a, const simd& b) { return apply(a, b, [](T x, T y) { return x + y; }); }
+		friend simd operator-(const simd& a, const simd& b) { return apply(a, b, [](T x, T y) { return x - y; }); }
+		friend simd operator*(const simd& a, const simd& b) { return apply(a, b, [](T x, T y) { return x * y; }); }
+		friend simd operator/(const simd& a, const simd& b) { return apply(a, b, [](T x, T y) { return x / y; }); }
+		friend simd operator-(const simd& a) { return apply(a, a, [](T x, T) { return -x; }); }
+
+		friend mask operator==(const simd& a, const simd& b) { return compare(a, b, [](T x, T y) { return x == y; }); }
+		friend mask operator!=(const simd& a, const simd& b) { return compare(a, b, [](T x, T y) { return x != y; }); }
+		friend mask operator<(const simd& a, const simd& b) { return compare(a, b, [](T x, T y) { return x < y; }); }
+		friend mask operator<=(const simd& a, const simd& b) { return compare(a, b, [](T x, T y) { return x <= y; }); }
+		friend mask operator>(const simd& a, const simd& b) { return compare(a, b, [](T x, T y) { return x > y; }); }
+		friend mask operator>=(const simd& a, const simd& b) { return compare(a, b, [](T x, T y) { return x >= y; }); }
+
+		friend simd fma(const simd& a, const simd& b, const simd& c) { simd r; for (size_t i = 0; i < W; i++) r.v[i] = a.v[i] * b.v[i] + c.v[i]; return r; }
+		friend simd min(const simd& a, const simd& b) { return apply(a, b, [](T x, T y) { return y < x ? y : x; }); }
+		friend simd max(const simd& a, const simd& b) { return apply(a, b, [](T x, T y) { return x < y ? y : x; }); }
+		friend simd abs(const simd& a) { return apply(a, a, [](T x, T) { return std::abs(x); }); }
+		friend simd sqrt(const simd& a) { return apply(a, a, [](T x, T) { return std::sqrt(x); }); }
+		friend simd floor(const simd& a) { return apply(a, a, [](T x, T) { return std::floor(x); }); }
+		friend simd rsqrt(const simd& a) { return apply(a, a, [](T x, T) { return T(1) / std::sqrt(x); }); }
+		friend simd rcp(const simd& a) { return apply(a, a, [](T x, T) { return T(1) / x; }); }
+
+		friend simd select(const mask& m, const simd& a, const simd& b)
+		{
+			simd r;
+			for (size_t i = 0; i < W; i++)
+				r.v[i] = m.lanes[i] ? a.v[i] : b.v[i];
+			return r;
+		}
+	};
+
+	/*
+	* SSE2 backend
+	*/
+
+#ifdef GMATH_SIMD_SSE2
+	template<>
+	struct simd_mask<float, 4>
+	{
+		__m128 m;
+
+		bool any() const { return _mm_movemask_ps(m) != 0; }
+		bool all() const { return _mm_movemask_ps(m) == 0xF; }
+
+		friend simd_mask operator&(const simd_mask& a, const simd_mask& b) { return { _mm_and_ps(a.m, b.m) }; }
+		friend simd_mask operator|(const simd_mask& a, const simd_mask& b) { return { _mm_or_ps(a.m, b.m) }; }
+		friend simd_mask operator!(const simd_mask& a) { return { _mm_xor_ps(a.m, _mm_castsi128_ps(_mm_set1_epi32(-1))) }; }
+	};
+
+	template<>
+	struct simd<float, 4> : simd_base<float, 4, simd<float, 4>>
+	{
+		using mask = simd_mask<float, 4>;
+
+		__m128 v;
+
+		simd() = default;
+		simd(const __m128& native) : v(native) {}
+		simd(const float& s) : v(_mm_set1_ps(s)) {}
+
+		static simd load(const float* p) { return _mm_loadu_ps(p); }
+		void store(float* p) const { _mm_storeu_ps(p, v); }
+
+		friend simd operator+(const simd& a, const simd& b) { return _mm_add_ps(a.v, b.v); }
+		friend simd operator-(const simd& a, const simd& b) { return _mm_sub_ps(a.v, b.v); }
+		friend simd operator*(const simd& a, const simd& b) { return _mm_mul_ps(a.v, b.v); }
+		friend simd operator/(const simd& a, const simd& b) { return _mm_div_ps(a.v, b.v); }
+		friend simd operator-(const simd& a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+
+		friend mask operator==(const simd& a, const simd& b) { return { _mm_cmpeq_ps(a.v, b.v) }; }
+		friend mask operator!=(const simd& a, const simd& b) { return { _mm_cmpneq_ps(a.v, b.v) }; }
+		friend mask operator<(const simd& a, const simd& b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+		friend mask operator<=(const simd& a, const simd& b) { return { _mm_cmple_ps(a.v, b.v) }; }
+		friend mask operator>(const simd& a, const simd& b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+		friend mask operator>=(const simd& a, const simd& b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+
+#ifdef GMATH_SIMD_FMA
+		friend simd fma(const simd& a, const simd& b, const simd& c) { return _mm_fmadd_ps(a.v, b.v, c.v); }
+#else
+		friend simd fma(const simd& a, const simd& b, const simd& c) { return _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v); }
+#endif
+		friend simd min(const simd& a, const simd& b) { return _mm_min_ps(a.v, b.v); }
+		friend simd max(const simd& a, const simd& b) { return _mm_max_ps(a.v, b.v); }
+		friend simd abs(const simd& a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+		friend simd sqrt(const simd& a) { return _mm_sqrt_ps(a.v); }
+		friend simd floor(const simd& a)
+		{
+			// Truncate and step down where that rounded up, values of 2^23 and above are integral already
+			__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+			t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)));
+			__m128 small = _mm_cmplt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v), _mm_set1_ps(8388608.0f));
+			return _mm_or_ps(_mm_and_ps(small, t), _mm_andnot_ps(small, a.v));
+		}
+		friend simd rsqrt(const simd& a) { return _mm_rsqrt_ps(a.v); }
+		friend simd rcp(const simd& a) { return _mm_rcp_ps(a.v); }
+		friend simd select(const mask& m, const simd& a, const simd& b) { return _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v)); }
+	};
+
+	template<>
+	struct simd_mask<double, 2>
+	{
+		__m128d m;
+
+		bool any() const { return _mm_movemask_pd(m) != 0; }
+		bool all() const { return _mm_movemask_pd(m) == 0x3; }
+
+		friend simd_mask operator&(const simd_mask& a, const simd_mask& b) { return { _mm_and_pd(a.m, b.m) }; }
+		friend simd_mask operator|(const simd_mask& a, const simd_mask& b) { return { _mm_or_pd(a.m, b.m) }; }
+		friend simd_mask operator!(const simd_mask& a) { return { _mm_xor_pd(a.m, _mm_castsi128_pd(_mm_set1_epi32(-1))) }; }
+	};
+
+	template<>
+	struct simd<double, 2> : simd_base<double, 2, simd<double, 2>>
+	{
+		using mask = simd_mask<double, 2>;
+
+		__m128d v;
+
+		simd() = default;
+		simd(const __m128d& native) : v(native) {}
+		simd(const double& s) : v(_mm_set1_pd(s)) {}
+
+		static simd load(const double* p) { return _mm_loadu_pd(p); }
+		void store(double* p) const { _mm_storeu_pd(p, v); }
+
+		friend simd operator+(const simd& a, const simd& b) { return _mm_add_pd(a.v, b.v); }
+		friend simd operator-(const simd& a, const simd& b) { return _mm_sub_pd(a.v, b.v); }
+		friend simd operator*(const simd& a, const simd& b) { return _mm_mul_pd(a.v, b.v); }
+		friend simd operator/(const simd& a, const simd& b) { return _mm_div_pd(a.v, b.v); }
+		friend simd operator-(const simd& a) { return _mm_xor_pd(a.v, _mm_set1_pd(-0.0)); }
+
+		friend mask operator==(const simd& a, const simd& b) { return { _mm_cmpeq_pd(a.v, b.v) }; }
+		friend mask operator!=(const simd& a, const simd& b) { return { _mm_cmpneq_pd(a.v, b.v) }; }
+		friend mask operator<(const simd& a, const simd& b) { return { _mm_cmplt_pd(a.v, b.v) }; }
+		friend mask operator<=(const simd& a, const simd& b) { return { _mm_cmple_pd(a.v, b.v) }; }
+		friend mask operator>(const simd& a, const simd& b) { return { _mm_cmpgt_pd(a.v, b.v) }; }
+		friend mask operator>=(const simd& a, const simd& b) { return { _mm_cmpge_pd(a.v, b.v) }; }
+
+#ifdef GMATH_SIMD_FMA
+		friend simd fma(const simd& a, const simd& b, const simd& c) { return _mm_fmadd_pd(a.v, b.v, c.v); }
+#else
+		friend simd fma(const simd& a, const simd& b, const simd& c) { return _mm_add_pd(_mm_mul_pd(a.v, b.v), c.v); }
+#endif
+		friend simd min(const simd& a, const simd& b) { return _mm_min_pd(a.v, b.v); }
+		friend simd max(const simd& a, const simd& b) { return _mm_max_pd(a.v, b.v); }
+		friend simd abs(const simd& a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a.v); }
+		friend simd sqrt(const simd& a) { return _mm_sqrt_pd(a.v); }
+		friend simd floor(const simd& a)
+		{
+			double lanes[2];
+			_mm_storeu_pd(lanes, a.v);
+			return _mm_setr_pd(std::floor(lanes[0]), std::floor(lanes[1]));
+		}
+		friend simd rsqrt(const simd& a) { return _mm_div_pd(_mm_set1_pd(1.0), _mm_sqrt_pd(a.v)); }
+		friend simd rcp(const simd& a) { return _mm_div_pd(_mm_set1_pd(1.0), a.v); }
+		friend simd select(const mask& m, const simd& a, const simd& b) { return _mm_or_pd(_mm_and_pd(m.m, a.v), _mm_andnot_pd(m.m, b.v)); }
+	};
+#endif
+
+	/*
+	* AVX backend
+	*/
+
+#ifdef GMATH_SIMD_AVX
+	template<>
+	struct simd_mask<float, 8>
+	{
+		__m256 m;
+
+		bool any() const { return _mm256_movemask_ps(m) != 0; }
+		bool all() const { return _mm256_movemask_ps(m) == 0xFF; }
+
+		friend simd_mask operator&(const simd_mask& a, const simd_mask& b) { return { _mm256_and_ps(a.m, b.m) }; }
+		friend simd_mask operator|(const simd_mask& a, const simd_mask& b) { return { _mm256_or_ps(a.m, b.m) }; }
+		friend simd_mask operator!(const simd_mask& a) { return { _mm256_xor_ps(a.m, _mm256_castsi256_ps(_mm256_set1_epi32(-1))) }; }
+	};
+
+	template<>
+	struct simd<float, 8> : simd_base<float, 8, simd<float, 8>>
+	{
+		using mask = simd_mask<float, 8>;
+
+		__m256 v;
+
+		simd() = default;
+		simd(const __m256& native) : v(native) {}
+		simd(const float& s) : v(_mm256_set1_ps(s)) {}
+
+		static simd load(const float* p) { return _mm256_loadu_ps(p); }
+		void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+		friend simd operator+(const simd& a, const simd& b) { return _mm256_add_ps(a.v, b.v); }
+		friend simd operator-(const simd& a, const simd& b) { return _mm256_sub_ps(a.v, b.v); }
+		friend simd operator*(const simd& a, const simd& b) { return _mm256_mul_ps(a.v, b.v); }
+		friend simd operator/(const simd& a, const simd& b) { return _mm256_div_ps(a.v, b.v); }
+		friend simd operator-(const simd& a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+
+		friend mask operator==(const simd& a, const simd& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+		friend mask operator!=(const simd& a, const simd& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ) }; }
+		friend mask operator<(const simd& a, const simd& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+		friend mask operator<=(const simd& a, const simd& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+		friend mask operator>(const simd& a, const simd& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+		friend mask operator>=(const simd& a, const simd& b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+
+#ifdef GMATH_SIMD_FMA
+		friend simd fma(const simd& a, const simd& b, const simd& c) { return _mm256_fmadd_ps(a.v, b.v, c.v); }
+#else
+		friend simd fma(const simd& a, const simd& b, const simd& c) { return _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v); }
+#endif
+		friend simd min(const simd& a, const simd& b) { return _mm256_min_ps(a.v, b.v); }
+		friend simd max(const simd& a, const simd& b) { return _mm256_max_ps(a.v, b.v); }
+		friend simd abs(const simd& a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+		friend simd sqrt(const simd& a) { return _mm256_sqrt_ps(a.v); }
+		friend simd floor(const simd& a) { return _mm256_floor_ps(a.v); }
+		friend simd rsqrt(const simd& a) { return _mm256_rsqrt_ps(a.v); }
+		friend simd rcp(const simd& a) { return _mm256_rcp_ps(a.v); }
+		friend simd select(const mask& m, const simd& a, const simd& b) { return _mm256_blendv_ps(b.v, a.v, m.m); }
+	};
+
+	template<>
+	struct simd_mask<double, 4>
+	{
+		__m256d m;
+
+		bool any() const { return _mm256_movemask_pd(m) != 0; }
+		bool all() const { return _mm256_movemask_pd(m) == 0xF; }
+
+		friend simd_mask operator&(const simd_mask& a, const simd_mask& b) { return { _mm256_and_pd(a.m, b.m) }; }
+		friend simd_mask operator|(const simd_mask& a, const simd_mask& b) { return { _mm256_or_pd(a.m, b.m) }; }
+		friend simd_mask operator!(const simd_mask& a) { return { _mm256_xor_pd(a.m, _mm256_castsi256_pd(_mm256_set1_epi32(-1))) }; }
+	};
+
+	template<>
+	struct simd<double, 4> : simd_base<double, 4, simd<double, 4>>
+	{
+		using mask = simd_mask<double, 4>;
+
+		__m256d v;
+
+		simd() = default;
+		simd(const __m256d& native) : v(native) {}
+		simd(const double& s) : v(_mm256_set1_pd(s)) {}
+
+		static simd load(const double* p) { return _mm256_loadu_pd(p); }
+		void store(double* p) const { _mm256_storeu_pd(p, v); }
+
+		friend simd operator+(const simd& a, const simd& b) { return _mm256_add_pd(a.v, b.v); }
+		friend simd operator-(const simd& a, const simd& b) { return _mm256_sub_pd(a.v, b.v); }
+		friend simd operator*(const simd& a, const simd& b) { return _mm256_mul_pd(a.v, b.v); }
+		friend simd operator/(const simd& a, const simd& b) { return _mm256_div_pd(a.v, b.v); }
+		friend simd operator-(const simd& a) { return _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)); }
+
+		friend mask operator==(const simd& a, const simd& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ) }; }
+		friend mask operator!=(const simd& a, const simd& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_NEQ_UQ) }; }
+		friend mask operator<(const simd& a, const simd& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ) }; }
+		friend mask operator<=(const simd& a, const simd& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ) }; }
+		friend mask operator>(const simd& a, const simd& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ) }; }
+		friend mask operator>=(const simd& a, const simd& b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ) }; }
+
+#ifdef GMATH_SIMD_FMA
+		friend simd fma(const simd& a, const simd& b, const simd& c) { return _mm256_fmadd_pd(a.v, b.v, c.v); }
+#else
+		friend simd fma(const simd& a, const simd& b, const simd& c) { return _mm256_add_pd(_mm256_mul_pd(a.v, b.v), c.v); }
+#endif
+		friend simd min(const simd& a, const simd& b) { return _mm256_min_pd(a.v, b.v); }
+		friend simd max(const simd& a, const simd& b) { return _mm256_max_pd(a.v, b.v); }
+		friend simd abs(const simd& a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); }
+		friend simd sqrt(const simd& a) { return _mm256_sqrt_pd(a.v); }
+		friend simd floor(const simd& a) { return _mm256_floor_pd(a.v); }
+		friend simd rsqrt(const simd& a) { return _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(a.v)); }
+		friend simd rcp(const simd& a) { return _mm256_div_pd(_mm256_set1_pd(1.0), a.v); }
+		friend simd select(const mask& m, const simd& a, const simd& b) { return _mm256_blendv_pd(b.v, a.v, m.m); }
+	};
+#endif
+
+	/*
+	* AVX-512 backend, masks live in the k registers
+	*/
+
+#ifdef GMATH_SIMD_AVX512
+	template<>
+	struct simd_mask<float, 16>
+	{
+		__mmask16 m;
+
+		bool any() const { return m != 0; }
+		bool all() const { return m == 0xFFFF; }
+
+		friend simd_mask operator&(const simd_mask& a, const simd_mask& b) { return { static_cast<__mmask16>(a.m & b.m) }; }
+		friend simd_mask operator|(const simd_mask& a, const simd_mask& b) { return { static_cast<__mmask16>(a.m | b.m) }; }
+		friend simd_mask operator!(const simd_mask& a) { return { static_cast<__mmask16>(~a.m) }; }
+	};
+
+	template<>
+	struct simd<float, 16> : simd_base<float, 16, simd<float, 16>>
+	{
+		using mask = simd_mask<float, 16>;
+
+		__m512 v;
+
+		simd() = default;
+		simd(const __m512& native) : v(native) {}
+		simd(const float& s) : v(_mm512_set1_ps(s)) {}
+
+		static simd load(const float* p) { return _mm512_loadu_ps(p); }
+		void store(float* p) const { _mm512_storeu_ps(p, v); }
+
+		friend simd operator+(const simd& a, const simd& b) { return _mm512_add_ps(a.v, b.v); }
+		friend simd operator-(const simd& a, const simd& b) { return _mm512_sub_ps(a.v, b.v); }
+		friend simd operator*(const simd& a, const simd& b) { return _mm512_mul_ps(a.v, b.v); }
+		friend simd operator/(const simd& a, const simd& b) { return _mm512_div_ps(a.v, b.v); }
+		friend simd operator-(const simd& a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a.v), _mm512_set1_epi32(static_cast<int>(0x80000000u)))); }
+
+		friend mask operator==(const simd& a, const simd& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ) }; }
+		friend mask operator!=(const simd& a, const simd& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_NEQ_UQ) }; }
+		friend mask operator<(const simd& a, const simd& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ) }; }
+		friend mask operator<=(const simd& a, const simd& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ) }; }
+		friend mask operator>(const simd& a, const simd& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ) }; }
+		friend mask operator>=(const simd& a, const simd& b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ) }; }
+
+		friend simd fma(const simd& a, const simd& b, const simd& c) { return _mm512_fmadd_ps(a.v, b.v, c.v); }
+		friend simd min(const simd& a, const simd& b) { return _mm512_min_ps(a.v, b.v); }
+		friend simd max(const simd& a, const simd& b) { return _mm512_max_ps(a.v, b.v); }
+		friend simd abs(const simd& a) { return _mm512_abs_ps(a.v); }
+		friend simd sqrt(const simd& a) { return _mm512_sqrt_ps(a.v); }
+		friend simd floor(const simd& a) { return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+		friend simd rsqrt(const simd& a) { return _mm512_rsqrt14_ps(a.v); }
+		friend simd rcp(const simd& a) { return _mm512_rcp14_ps(a.v); }
+		friend simd select(const mask& m, const simd& a, const simd& b) { return _mm512_mask_blend_ps(m.m, b.v, a.v); }
+	};
+
+	template<>
+	struct simd_mask<double, 8>
+	{
+		__mmask8 m;
+
+		bool any() const { return m != 0; }
+		bool all() const { return m == 0xFF; }
+
+		friend simd_mask operator&(const simd_mask& a, const simd_mask& b) { return { static_cast<__mmask8>(a.m & b.m) }; }
+		friend simd_mask operator|(const simd_mask& a, const simd_mask& b) { return { static_cast<__mmask8>(a.m | b.m) }; }
+		friend simd_mask operator!(const simd_mask& a) { return { static_cast<__mmask8>(~a.m) }; }
+	};
+
+	template<>
+	struct simd<double, 8> : simd_base<double, 8, simd<double, 8>>
+	{
+		using mask = simd_mask<double, 8>;
+
+		__m512d v;
+
+		simd() = default;
+		simd(const __m512d& native) : v(native) {}
+		simd(const double& s) : v(_mm512_set1_pd(s)) {}
+
+		static simd load(const double* p) { return _mm512_loadu_pd(p); }
+		void store(double* p) const { _mm512_storeu_pd(p, v); }
+
+		friend simd operator+(const simd& a, const simd& b) { return _mm512_add_pd(a.v, b.v); }
+		friend simd operator-(const simd& a, const simd& b) { return _mm512_sub_pd(a.v, b.v); }
+		friend simd operator*(const simd& a, const simd& b) { return _mm512_mul_pd(a.v, b.v); }
+		friend simd operator/(const simd& a, const simd& b) { return _mm512_div_pd(a.v, b.v); }
+		friend simd operator-(const simd& a) { return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a.v), _mm512_set1_epi64(static_cast<long long>(0x8000000000000000ull)))); }
+
+		friend mask operator==(const simd& a, const simd& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ) }; }
+		friend mask operator!=(const simd& a, const simd& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_NEQ_UQ) }; }
+		friend mask operator<(const simd& a, const simd& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ) }; }
+		friend mask operator<=(const simd& a, const simd& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_LE_OQ) }; }
+		friend mask operator>(const simd& a, const simd& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ) }; }
+		friend mask operator>=(const simd& a, const simd& b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_GE_OQ) }; }
+
+		friend simd fma(const simd& a, const simd& b, const simd& c) { return _mm512_fmadd_pd(a.v, b.v, c.v); }
+		friend simd min(const simd& a, const simd& b) { return _mm512_min_pd(a.v, b.v); }
+		friend simd max(const simd& a, const simd& b) { return _mm512_max_pd(a.v, b.v); }
+		friend simd abs(const simd& a) { return _mm512_abs_pd(a.v); }
+		friend simd sqrt(const simd& a) { return _mm512_sqrt_pd(a.v); }
+		friend simd floor(const simd& a) { return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+		friend simd rsqrt(const simd& a) { return _mm512_div_pd(_mm512_set1_pd(1.0), _mm512_sqrt_pd(a.v)); }
+		friend simd rcp(const simd& a) { return _mm512_div_pd(_mm512_set1_pd(1.0), a.v); }
+		friend simd select(const mask& m, const simd& a, const simd& b) { return _mm512_mask_blend_pd(m.m, b.v, a.v); }
+	};
+#endif
+
+	/*
+	* Backend independent helpers, they go through memory so they are meant for the edges of a loop, not its body.
+	*/
+
+	// r[i] = a[I[i]]
+	template<size_t... I, typename T, size_t W>
+	simd<T, W> shuffle(const simd<T, W>& a)
+	{
+		static_assert(sizeof...(I) == W, "shuffle needs one index per lane");
+		T in[W];
+		a.store(in);
+		T out[W] = { in[I]... };
+		return simd<T, W>::load(out);
+	}
+
+	template<typename T, size_t W>
+	T reduce_add(const simd<T, W>& a)
+	{
+		T lanes[W];
+		a.store(lanes);
+		T sum{};
+		for (size_t i = 0; i < W; i++)
+			sum += lanes[i];
+		return sum;
+	}
+
+	template<typename T, size_t W>
+	T reduce_min(const simd<T, W>& a)
+	{
+		T lanes[W];
+		a.store(lanes);
+		return *std::min_element(lanes, lanes + W);
+	}
+
+	template<typename T, size_t W>
+	T reduce_max(const simd<T, W>& a)
+	{
+		T lanes[W];
+		a.store(lanes);
+		return *std::max_element(lanes, lanes + W);
+	}
+
+	// Widest register the compiler targets for T, 1 without any SIMD backend
+	template<typename T>
+	constexpr size_t simd_native_width()
+	{
+#if defined(GMATH_SIMD_AVX512)
+		return 64 / sizeof(T);
+#elif defined(GMATH_SIMD_AVX)
+		return 32 / sizeof(T);
+#elif defined(GMATH_SIMD_SSE2)
+		return 16 / sizeof(T);
+#else
+		return 1;
+#endif
+	}
+
+	template<typename T>
+	using simd_native = simd<T, simd_native_width<T>()>;
+
+	using simd4f = simd<float, 4>;
+	using simd8f = simd<float, 8>;
+	using simd16f = simd<float, 16>;
+	using simd2d = simd<double, 2>;
+	using simd4d = simd<double, 4>;
+	using simd8d = simd<double, 8>;
+}
\ No newline at end of file
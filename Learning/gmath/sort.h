@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "gmath.h"
+#include "arena.h"
+#include "vec.h"
+#include "color.h"
+#include "color_stats.h"
+#include "parallel.h"
+
+namespace gmath
+{
+	/*
+	* Sorting by a cached key. The key of every element is computed once, squared magnitude for vectors and luminance
+	* for colours, and turned into an unsigned integer with the same order. A least significant digit radix sort then
+	* moves the keys together with the element indices, so the elements themselves are moved once at the end, if at all.
+	* The sort is stable and every pass counts and scatters in parallel chunks.
+	* Every function takes an optional allocator for its result, the keys and the radix buffers are taken from it as
+	* well, so with an arena_allocator a sort does not reach the heap.
+	*/
+
+	namespace detail
+	{
+		// Unsigned integer with the same order as the float, negative values have all bits flipped, the others only the sign
+		inline uint32_t ordered_key(float f)
+		{
+			uint32_t bits = std::bit_cast<uint32_t>(f);
+			return bits ^ ((bits >> 31) ? 0xFFFFFFFFu : 0x80000000u);
+		}
+
+		inline uint64_t ordered_key(double d)
+		{
+			uint64_t bits = std::bit_cast<uint64_t>(d);
+			return bits ^ ((bits >> 63) ? 0xFFFFFFFFFFFFFFFFull : 0x8000000000000000ull);
+		}
+
+		// Unsigned integers are their own key, signed ones only need the sign bit flipped
+		template<typename I> requires std::is_integral_v<I>
+		std::make_unsigned_t<I> ordered_key(I i)
+		{
+			using U = std::make_unsigned_t<I>;
+			if constexpr (std::is_signed_v<I>)
+				return static_cast<U>(static_cast<U>(i) ^ (U(1) << (sizeof(I) * 8 - 1)));
+			else
+				return i;
+		}
+
+		// Squared magnitudes of 8 and 16 bit vectors are summed exactly in 64 bits, wider integers in double
+		template<typename T>
+		using magnitude_type = std::conditional_t<std::is_floating_point_v<T>, T, std::conditional_t<(sizeof(T) <= 2), uint64_t, double>>;
+
+		/*
+		* Sorts keys and carries indices along, 8 bits per pass. Each chunk counts its digits, the offsets are laid out
+		* digit by digit and chunk by chunk so the scatter keeps the order of equal keys. Passes where every key has
+		* the same digit are skipped, which is common for the high bits of keys in a narrow range.
+		*/
+		template<typename Keys, typename Indices>
+		void radix_sort(Keys& keys, Indices& indices)
+		{
+			using K = typename Keys::value_type;
+			using histogram_type = std::array<size_t, 256>;
+			size_t count = keys.size();
+			size_t grain = get_parallel_config().batch_grain;
+			size_t chunks = parallel_chunk_count(count, grain);
+			std::vector<histogram_type, rebind_allocator<typename Keys::allocator_type, histogram_type>> offsets(chunks, keys.get_allocator());
+			Keys sorted_keys(count, keys.get_allocator());
+			Indices sorted_indices(count, indices.get_allocator());
+
+			for (size_t shift = 0; shift < sizeof(K) * 8; shift += 8)
+			{
+				parallel_for(count, grain, [&](size_t chunk, size_t first, size_t last)
+				{
+					std::array<size_t, 256>& histogram = offsets[chunk];
+					histogram.fill(0);
+					for (size_t i = first; i < last; i++)
+						histogram[(keys[i] >> shift) & 0xFF]++;
+				});
+
+				size_t total = 0;
+				bool trivial = false;
+				for (size_t digit = 0; digit < 256; digit++)
+				{
+					size_t digit_count = 0;
+					for (size_t chunk = 0; chunk < chunks; chunk++)
+					{
+						size_t n = offsets[chunk][digit];
+						offsets[chunk][digit] = total;
+						total += n;
+						digit_count += n;
+					}
+					trivial = trivial || digit_count == count;
+				}
+				if (trivial)
+					continue;
+
+				parallel_for(count, grain, [&](size_t chunk, size_t first, size_t last)
+				{
+					std::array<size_t, 256>& position = offsets[chunk];
+					for (size_t i = first; i < last; i++)
+					{
+						size_t p = position[(keys[i] >> shift) & 0xFF]++;
+						sorted_keys[p] = keys[i];
+						sorted_indices[p] = indices[i];
+					}
+				});
+				keys.swap(sorted_keys);
+				indices.swap(sorted_indices);
+			}
+		}
+
+		// Computes the ordered key of every element through key(element) and sorts the indices by it
+		template<typename P, typename F, typename Alloc>
+		std::vector<uint32_t, Alloc> order_by(const P* elements, size_t count, F key, const Alloc& alloc)
+		{
+			if (count > std::numeric_limits<uint32_t>::max())
+				throw std::runtime_error("gmath: sorting is limited to 2^32 - 1 elements");
+
+			using K = decltype(ordered_key(key(elements[0])));
+			std::vector<K, rebind_allocator<Alloc, K>> keys(count, alloc);
+			std::vector<uint32_t, Alloc> indices(count, alloc);
+			parallel_batch(count, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					keys[i] = ordered_key(key(elements[i]));
+					indices[i] = static_cast<uint32_t>(i);
+				}
+			});
+			radix_sort(keys, indices);
+			return indices;
+		}
+	}
+
+	// dst[i] = src[order[i]], dst must not overlap src. Elements are copy constructed in place, vector has no copy assignment
+	template<typename P>
+	void permute(const P* src, const uint32_t* order, P* dst, size_t count)
+	{
+		static_assert(std::is_trivially_destructible_v<P>, "permute overwrites elements without destroying them");
+		parallel_batch(count, [&](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+				std::construct_at(dst + i, src[order[i]]);
+		});
+	}
+
+	// Indices of keys from the smallest to the largest key, equal keys keep their order
+	template<typename Alloc = std::allocator<uint32_t>>
+	std::vector<uint32_t, Alloc> order_by_keys(const float* keys, size_t count, const Alloc& alloc = Alloc())
+	{
+		return detail::order_by(keys, count, [](float k) { return k; }, alloc);
+	}
+
+	template<typename Alloc = std::allocator<uint32_t>>
+	std::vector<uint32_t, Alloc> order_by_keys(const double* keys, size_t count, const Alloc& alloc = Alloc())
+	{
+		return detail::order_by(keys, count, [](double k) { return k; }, alloc);
+	}
+
+	/*
+	* Vectors by increasing magnitude, ordered on the squared magnitude so no square root is taken
+	*/
+
+	template<typename T, size_t N, typename Alloc = std::allocator<uint32_t>>
+	std::vector<uint32_t, Alloc> order_by_magnitude(const vector<T, N>* v, size_t count, const Alloc& alloc = Alloc())
+	{
+		using M = detail::magnitude_type<T>;
+		return detail::order_by(v, count, [](const vector<T, N>& p)
+		{
+			M sqr = M(0);
+			for (size_t d = 0; d < N; d++)
+			{
+				if constexpr (std::is_same_v<M, uint64_t>)
+					sqr += static_cast<uint64_t>(static_cast<int64_t>(p[d]) * static_cast<int64_t>(p[d]));
+				else
+					sqr += static_cast<M>(p[d]) * static_cast<M>(p[d]);
+			}
+			return sqr;
+		}, alloc);
+	}
+
+	template<typename T, size_t N, typename Alloc = std::allocator<vector<T, N>>>
+	std::vector<vector<T, N>, Alloc> sorted_by_magnitude(const vector<T, N>* v, size_t count, const Alloc& alloc = Alloc())
+	{
+		std::vector<uint32_t, rebind_allocator<Alloc, uint32_t>> order = order_by_magnitude(v, count, rebind_allocator<Alloc, uint32_t>(alloc));
+		std::vector<vector<T, N>, Alloc> sorted(count, alloc);
+		permute(v, order.data(), sorted.data(), count);
+		return sorted;
+	}
+
+	template<typename T, size_t N, typename Alloc = std::allocator<uint32_t>>
+	std::vector<uint32_t, Alloc> order_by_magnitude(const std::vector<vector<T, N>>& v, const Alloc& alloc = Alloc())
+	{
+		return order_by_magnitude(v.data(), v.size(), alloc);
+	}
+
+	template<typename T, size_t N, typename Alloc = std::allocator<vector<T, N>>>
+	std::vector<vector<T, N>, Alloc> sorted_by_magnitude(const std::vector<vector<T, N>>& v, const Alloc& alloc = Alloc())
+	{
+		return sorted_by_magnitude(v.data(), v.size(), alloc);
+	}
+
+	/*
+	* Colours by increasing luminance, see luminance() in color_stats.h
+	*/
+
+	template<typename T, typename Alloc = std::allocator<uint32_t>>
+	std::vector<uint32_t, Alloc> order_by_luminance(const color_base<T>* c, size_t count, const Alloc& alloc = Alloc())
+	{
+		return detail::order_by(c, count, [](const color_base<T>& p) { return luminance(p); }, alloc);
+	}
+
+	template<typename T, typename Alloc = std::allocator<color_base<T>>>
+	std::vector<color_base<T>, Alloc> sorted_by_luminance(const color_base<T>* c, size_t count, const Alloc& alloc = Alloc())
+	{
+		std::vector<uint32_t, rebind_allocator<Alloc, uint32_t>> order = order_by_luminance(c, count, rebind_allocator<Alloc, uint32_t>(alloc));
+		std::vector<color_base<T>, Alloc> sorted(count, alloc);
+		permute(c, order.data(), sorted.data(), count);
+		return sorted;
+	}
+
+	template<typename T, typename Alloc = std::allocator<uint32_t>>
+	std::vector<uint32_t, Alloc> order_by_luminance(const std::vector<color_base<T>>& c, const Alloc& alloc = Alloc())
+	{
+		return order_by_luminance(c.data(), c.size(), alloc);
+	}
+
+	template<typename T, typename Alloc = std::allocator<color_base<T>>>
+	std::vector<color_base<T>, Alloc> sorted_by_luminance(const std::vector<color_base<T>>& c, const Alloc& alloc = Alloc())
+	{
+		return sorted_by_luminance(c.data(), c.size(), alloc);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,372 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "gmath.h"
+#include "vec.h"
+#include "parallel.h"
+#include "simd.h"
+
+namespace gmath
+{
+	/*
+	* Cubic splines over vector<T, N> control points.
+	* Every segment is stored as the power basis a + b u + c u^2 + d u^3 in SoA order, one array per component and power,
+	* so Bezier, Catmull-Rom and B-spline curves share the same evaluation and forward differencing code.
+	* The curve parameter t runs from 0 to 1 over all segments, segment i covers [i / segments, (i + 1) / segments].
+	*/
+
+	enum class spline_type
+	{
+		// Segments of 4 points sharing their end points, 3n + 1 points give n segments
+		bezier,
+		// Uniform Catmull-Rom through every point but the first and last, n points give n - 3 segments
+		catmull_rom,
+		// Uniform cubic B-spline, C2 but does not pass through the points, n points give n - 3 segments
+		bspline
+	};
+
+	template<typename T, size_t N>
+	class spline
+	{
+	public:
+		spline() = default;
+
+		spline(const vector<T, N>* points, size_t count, spline_type type)
+		{
+			if (type == spline_type::bezier ? count < 4 || (count - 1) % 3 != 0 : count < 4)
+				throw std::runtime_error("gmath: not enough control points for the spline type");
+
+			segment_count = type == spline_type::bezier ? (count - 1) / 3 : count - 3;
+			size_t stride = type == spline_type::bezier ? 3 : 1;
+			for (size_t d = 0; d < N; d++)
+			{
+				for (size_t p = 0; p < 4; p++)
+					coefficients[d][p].resize(segment_count);
+			}
+
+			for (size_t s = 0; s < segment_count; s++)
+			{
+				const vector<T, N>* q = points + s * stride;
+				for (size_t d = 0; d < N; d++)
+				{
+					T p0 = q[0][d], p1 = q[1][d], p2 = q[2][d], p3 = q[3][d];
+					T basis[4];
+					switch (type)
+					{
+					case spline_type::bezier:
+						basis[0] = p0;
+						basis[1] = 3 * (p1 - p0);
+						basis[2] = 3 * (p0 - 2 * p1 + p2);
+						basis[3] = -p0 + 3 * p1 - 3 * p2 + p3;
+						break;
+					case spline_type::catmull_rom:
+						basis[0] = p1;
+						basis[1] = T(0.5) * (p2 - p0);
+						basis[2] = T(0.5) * (2 * p0 - 5 * p1 + 4 * p2 - p3);
+						basis[3] = T(0.5) * (-p0 + 3 * p1 - 3 * p2 + p3);
+						break;
+					default:
+						basis[0] = (p0 + 4 * p1 + p2) / 6;
+						basis[1] = (p2 - p0) / 2;
+						basis[2] = (p0 - 2 * p1 + p2) / 2;
+						basis[3] = (-p0 + 3 * p1 - 3 * p2 + p3) / 6;
+						break;
+					}
+					for (size_t p = 0; p < 4; p++)
+						coefficients[d][p][s] = basis[p];
+				}
+			}
+		}
+
+		spline(const std::vector<vector<T, N>>& points, spline_type type)
+			: spline(points.data(), points.size(), type) {}
+
+		size_t segments() const
+		{
+			return segment_count;
+		}
+
+		// Coefficient of u^power of every segment for one component
+		const T* coefficients_of(size_t dimension, size_t power) const
+		{
+			return coefficients[dimension][power].data();
+		}
+
+		// t is clamped to [0, 1]
+		vector<T, N> evaluate(T t) const
+		{
+			simd<T, 1> lanes[N];
+			evaluate_lanes<1>(simd<T, 1>(t), lanes, false);
+			vector<T, N> result;
+			for (size_t d = 0; d < N; d++)
+				result[d] = lanes[d][0];
+			return result;
+		}
+
+		// Derivative with respect to t, so it scales with the number of segments
+		vector<T, N> derivative(T t) const
+		{
+			simd<T, 1> lanes[N];
+			evaluate_lanes<1>(simd<T, 1>(t), lanes, true);
+			vector<T, N> result;
+			for (size_t d = 0; d < N; d++)
+				result[d] = lanes[d][0];
+			return result;
+		}
+
+		/*
+		* Batch
+		*/
+
+		void evaluate(const T* t, vector<T, N>* out, size_t count) const
+		{
+			parallel_batch(count, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i += lanes)
+				{
+					size_t n = std::min(lanes, last - i);
+					lane_type results[N];
+					evaluate_lanes<lanes>(load_partial(t + i, n), results, false);
+					for (size_t d = 0; d < N; d++)
+					{
+						T values[lanes];
+						results[d].store(values);
+						for (size_t l = 0; l < n; l++)
+							out[i + l][d] = values[l];
+					}
+				}
+			});
+		}
+
+		// Component d of the curve at t[i] goes to planes[d][i]
+		void evaluate(const T* t, T* const* planes, size_t count) const
+		{
+			parallel_batch(count, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i += lanes)
+				{
+					size_t n = std::min(lanes, last - i);
+					lane_type results[N];
+					evaluate_lanes<lanes>(load_partial(t + i, n), results, false);
+					for (size_t d = 0; d < N; d++)
+						store_partial(results[d], planes[d] + i, n);
+				}
+			});
+		}
+
+		/*
+		* Samples every segment at u = 0, 1 / steps, ..., (steps - 1) / steps plus the end point of the curve, so out holds
+		* segments() * steps + 1 points. Forward differencing replaces the cubic by three additions per sample and runs
+		* a register of segments at once, it restarts every segment so rounding cannot build up over the whole curve.
+		*/
+		void sample_uniform(size_t steps, vector<T, N>* out) const
+		{
+			if (segment_count == 0)
+				return;
+
+			steps = std::max<size_t>(1, steps);
+			T h = T(1) / static_cast<T>(steps);
+			T h2 = h * h, h3 = h2 * h;
+			size_t grain = std::max<size_t>(1, get_parallel_config().batch_grain / steps);
+
+			parallel_for(segment_count, grain, [&](size_t first, size_t last)
+			{
+				T values[lanes];
+				for (size_t s = first; s < last; s += lanes)
+				{
+					size_t n = std::min(lanes, last - s);
+					for (size_t d = 0; d < N; d++)
+					{
+						lane_type b = load_partial(coefficients[d][1].data() + s, n);
+						lane_type c = load_partial(coefficients[d][2].data() + s, n);
+						lane_type e = load_partial(coefficients[d][3].data() + s, n);
+
+						lane_type f = load_partial(coefficients[d][0].data() + s, n);
+						lane_type d1 = fma(e, lane_type(h3), fma(c, lane_type(h2), b * lane_type(h)));
+						lane_type d2 = fma(e, lane_type(6 * h3), c * lane_type(2 * h2));
+						lane_type d3 = e * lane_type(6 * h3);
+						for (size_t k = 0; k < steps; k++)
+						{
+							f.store(values);
+							for (size_t l = 0; l < n; l++)
+								out[(s + l) * steps + k][d] = values[l];
+							f += d1;
+							d1 += d2;
+							d2 += d3;
+						}
+					}
+				}
+			});
+			const vector<T, N> end = evaluate(T(1));
+			for (size_t d = 0; d < N; d++)
+				out[segment_count * steps][d] = end[d];
+		}
+
+	private:
+		static constexpr size_t lanes = simd_native_width<T>();
+		using lane_type = simd<T, lanes>;
+
+		std::vector<T> coefficients[N][4];
+		size_t segment_count{};
+
+		static lane_type load_partial(const T* p, size_t n)
+		{
+			if (n == lanes)
+				return lane_type::load(p);
+			T values[lanes]{};
+			std::copy(p, p + n, values);
+			return lane_type::load(values);
+		}
+
+		static void store_partial(const lane_type& v, T* p, size_t n)
+		{
+			if (n == lanes)
+			{
+				v.store(p);
+				return;
+			}
+			T values[lanes];
+			v.store(values);
+			std::copy(values, values + n, p);
+		}
+
+		// Finds the segment of every lane, gathers its coefficients and runs Horner's scheme per component
+		template<size_t W>
+		void evaluate_lanes(const simd<T, W>& t, simd<T, W>* out, bool derivative) const
+		{
+			using V = simd<T, W>;
+			if (segment_count == 0)
+			{
+				for (size_t d = 0; d < N; d++)
+					out[d] = V(T(0));
+				return;
+			}
+
+			V x = min(max(t, V(T(0))), V(T(1))) * V(static_cast<T>(segment_count));
+			V segment = min(floor(x), V(static_cast<T>(segment_count - 1)));
+			V u = x - segment;
+
+			T index[W];
+			segment.store(index);
+			for (size_t d = 0; d < N; d++)
+			{
+				T c[4][W];
+				for (size_t l = 0; l < W; l++)
+				{
+					size_t s = static_cast<size_t>(index[l]);
+					for (size_t p = 0; p < 4; p++)
+						c[p][l] = coefficients[d][p][s];
+				}
+
+				if (derivative)
+				{
+					V slope = fma(fma(V::load(c[3]) * V(T(3)), u, V::load(c[2]) * V(T(2))), u, V::load(c[1]));
+					out[d] = slope * V(static_cast<T>(segment_count));
+				}
+				else
+				{
+					out[d] = fma(fma(fma(V::load(c[3]), u, V::load(c[2])), u, V::load(c[1])), u, V::load(c[0]));
+				}
+			}
+		}
+	};
+
+	/*
+	* Maps distance along a spline to its parameter t in O(1).
+	* The curve is measured as a polyline of about resolution chords and the lengths are inverted into a table that is
+	* uniform in distance, so a query is one multiply, one lookup and a lerp. Chords underestimate the length by O(1 / resolution^2).
+	*/
+	template<typename T>
+	class arc_length_table
+	{
+	public:
+		arc_length_table() = default;
+
+		template<size_t N>
+		explicit arc_length_table(const spline<T, N>& curve, size_t resolution = 1024)
+		{
+			resolution = std::max<size_t>(1, resolution);
+			if (curve.segments() == 0)
+				return;
+
+			size_t steps = std::max<size_t>(1, (resolution + curve.segments() - 1) / curve.segments());
+			std::vector<vector<T, N>> points(curve.segments() * steps + 1);
+			curve.sample_uniform(steps, points.data());
+
+			std::vector<T> cumulative(points.size());
+			for (size_t i = 1; i < points.size(); i++)
+				cumulative[i] = cumulative[i - 1] + (points[i] - points[i - 1]).template magnitude<precision_exact>();
+			total = cumulative.back();
+
+			// Walks both arrays once, entry i is the t at distance total * i / resolution
+			table.resize(resolution + 1);
+			T last_index = static_cast<T>(points.size() - 1);
+			size_t j = 0;
+			for (size_t i = 0; i <= resolution; i++)
+			{
+				T distance = total * static_cast<T>(i) / static_cast<T>(resolution);
+				while (j + 2 < points.size() && cumulative[j + 1] < distance)
+					j++;
+				T chord = cumulative[j + 1] - cumulative[j];
+				T fraction = chord > 0 ? std::clamp((distance - cumulative[j]) / chord, T(0), T(1)) : T(0);
+				table[i] = (static_cast<T>(j) + fraction) / last_index;
+			}
+		}
+
+		T length() const
+		{
+			return total;
+		}
+
+		// distance is clamped to [0, length()]
+		T parameter(T distance) const
+		{
+			if (table.size() < 2 || total <= 0)
+				return T(0);
+
+			T resolution = static_cast<T>(table.size() - 1);
+			T x = std::clamp(distance / total, T(0), T(1)) * resolution;
+			size_t i = std::min(static_cast<size_t>(x), table.size() - 2);
+			T f = x - static_cast<T>(i);
+			return table[i] + (table[i + 1] - table[i]) * f;
+		}
+
+		void parameters(const T* distances, T* out, size_t count) const
+		{
+			parallel_batch(count, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i++)
+					out[i] = parameter(distances[i]);
+			});
+		}
+
+	private:
+		std::vector<T> table;
+		T total{};
+	};
+
+	// count points spaced evenly by distance from the start to the end of the curve, the parameters are kept in a buffer from alloc
+	template<typename T, size_t N, typename Alloc = std::allocator<T>>
+	void sample_constant_speed(const spline<T, N>& curve, const arc_length_table<T>& table, vector<T, N>* out, size_t count, const Alloc& alloc = Alloc())
+	{
+		if (count == 0)
+			return;
+
+		std::vector<T, Alloc> t(count, alloc);
+		T spacing = count > 1 ? table.length() / static_cast<T>(count - 1) : T(0);
+		parallel_batch(count, [&](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+				t[i] = table.parameter(spacing * static_cast<T>(i));
+		});
+		curve.evaluate(t.data(), out, count);
+	}
+
+	using spline2 = spline<float, 2>;
+	using spline3 = spline<float, 3>;
+}
\ No newline at end of file
@@ -7,9 +7,13 @@
 #include <sstream>
 
 #include "gmath.h"
+#include "avx_double.h"
 
 namespace gmath
 {
+	template<typename T, size_t N>
+	struct vector;
+
 	// Curiously Recurring Template Pattern for the base class of all vectors
 	template<typename T, typename CRTP>
 	class vector_base {
@@ -38,31 +42,39 @@ namespace gmath
 			return std::extent<decltype(CRTP::data)>::value;
 		}
 
+		template<typename P = default_precision_t<T>>
 		T magnitude() const
 		{
-			T sum{};
-			for (size_t i = 0; i < size(); i++)
-				sum += crtp().data[i] * crtp().data[i];
-			return gmath::sqrt<T>(sum);
+			GMATH_PROFILE_SCOPE(vector_magnitude);
+
+			return gmath::sqrt<T, P>(sqr_magnitude());
 		}
 
 		T sqr_magnitude() const
 		{
-			T unsquared_magnitude = magnitude();
-			return unsquared_magnitude * unsquared_magnitude;
+#ifdef GMATH_AVX
+			if constexpr (std::is_same_v<CRTP, vector<double, 4>>)
+				return detail::dot4d(crtp().data, crtp().data);
+#endif
+			T sum{};
+			for (size_t i = 0; i < size(); i++)
+				sum += crtp().data[i] * crtp().data[i];
+			return sum;
 		}
 
+		template<typename P = default_precision_t<T>>
 		void set_magnitude(const T& m)
 		{
-			normalize();
+			normalize<P>();
 			if (m > 1.0)
 				crtp() *= m;
 		}
 
+		template<typename P = default_precision_t<T>>
 		CRTP normalized() const
 		{
 			CRTP vec_normalized{ crtp() };
-			vec_normalized.normalize();
+			vec_normalized.template normalize<P>();
 			return vec_normalized;
 		}
 
@@ -73,13 +85,19 @@ namespace gmath
 			return ss.str();
 		}
 
+		template<typename P = default_precision_t<T>>
 		void normalize()
 		{
-			T m{ magnitude() };
-			if (m > 0)
-				crtp() /= m;
-			else
+			GMATH_PROFILE_SCOPE(vector_normalize);
+
+			// The approximate policies multiply by rsqrt instead of dividing by an approximate magnitude
+			T sqr{ sqr_magnitude() };
+			if (!(sqr > 0))
 				crtp().zero();
+			else if constexpr (std::is_same_v<P, precision_exact>)
+				crtp() /= gmath::sqrt<T, P>(sqr);
+			else
+				crtp() *= gmath::rsqrt<T, P>(sqr);
 		}
 
 		void zero()
@@ -95,12 +113,13 @@ namespace gmath
 			}
 		}
 
+		template<typename P = default_precision_t<T>>
 		static T distance(const CRTP& a, const CRTP& b)
 		{
 			T sum{};
 			for (size_t i = 0; i < a.size(); i++)
 				sum += abs(a[i] - b[i]);
-			return gmath::sqrt<T>(sum);
+			return gmath::sqrt<T, P>(sum);
 		}
 
 		static CRTP lerp(const CRTP& a, const CRTP& b, const float& t)
@@ -144,6 +163,10 @@ namespace gmath
 
 		static T dot(const CRTP& a, const CRTP& b)
 		{
+#ifdef GMATH_AVX
+			if constexpr (std::is_same_v<CRTP, vector<double, 4>>)
+				return detail::dot4d(a.data, b.data);
+#endif
 			T result{};
 			for (size_t i = 0; i < a.size(); i++)
 				result += a[i] * b[i];
@@ -454,6 +477,116 @@ namespace gmath
 		return a;
 	}
 
+#ifdef GMATH_AVX
+	/*
+	* vec4_precise overloads, preferred over the templates above for exact matches.
+	*/
+
+	inline vector<double, 4> operator+(const vector<double, 4>& a, const vector<double, 4>& b)
+	{
+		vector<double, 4> result;
+		detail::add4d(a.data, b.data, result.data);
+		return result;
+	}
+
+	inline vector<double, 4>& operator+=(vector<double, 4>& a, const vector<double, 4>& b)
+	{
+		detail::add4d(a.data, b.data, a.data);
+		return a;
+	}
+
+	inline vector<double, 4> operator-(const vector<double, 4>& a, const vector<double, 4>& b)
+	{
+		vector<double, 4> result;
+		detail::sub4d(a.data, b.data, result.data);
+		return result;
+	}
+
+	inline vector<double, 4>& operator-=(vector<double, 4>& a, const vector<double, 4>& b)
+	{
+		detail::sub4d(a.data, b.data, a.data);
+		return a;
+	}
+
+	inline vector<double, 4> operator*(const vector<double, 4>& a, const vector<double, 4>& b)
+	{
+		vector<double, 4> result;
+		detail::mul4d(a.data, b.data, result.data);
+		return result;
+	}
+
+	inline vector<double, 4>& operator*=(vector<double, 4>& a, const vector<double, 4>& b)
+	{
+		detail::mul4d(a.data, b.data, a.data);
+		return a;
+	}
+
+	inline vector<double, 4> operator/(const vector<double, 4>& a, const vector<double, 4>& b)
+	{
+		vector<double, 4> result;
+		detail::div4d(a.data, b.data, result.data);
+		return result;
+	}
+
+	inline vector<double, 4>& operator/=(vector<double, 4>& a, const vector<double, 4>& b)
+	{
+		detail::div4d(a.data, b.data, a.data);
+		return a;
+	}
+
+	inline vector<double, 4> operator+(const vector<double, 4>& a, const double& b)
+	{
+		vector<double, 4> result;
+		detail::add4d(a.data, b, result.data);
+		return result;
+	}
+
+	inline vector<double, 4>& operator+=(vector<double, 4>& a, const double& b)
+	{
+		detail::add4d(a.data, b, a.data);
+		return a;
+	}
+
+	inline vector<double, 4> operator-(const vector<double, 4>& a, const double& b)
+	{
+		vector<double, 4> result;
+		detail::sub4d(a.data, b, result.data);
+		return result;
+	}
+
+	inline vector<double, 4>& operator-=(vector<double, 4>& a, const double& b)
+	{
+		detail::sub4d(a.data, b, a.data);
+		return a;
+	}
+
+	inline vector<double, 4> operator*(const vector<double, 4>& a, const double& b)
+	{
+		vector<double, 4> result;
+		detail::mul4d(a.data, b, result.data);
+		return result;
+	}
+
+	inline vector<double, 4>& operator*=(vector<double, 4>& a, const double& b)
+	{
+		detail::mul4d(a.data, b, a.data);
+		return a;
+	}
+
+	inline vector<double, 4> operator/(const vector<double, 4>& a, const double& b)
+	{
+		vector<double, 4> result;
+		detail::div4d(a.data, b, result.data);
+		return result;
+	}
+
+	inline vector<double, 4>& operator/=(vector<double, 4>& a, const double& b)
+	{
+		detail::div4d(a.data, b, a.data);
+		return a;
+	}
+#endif
+
 	/*
 	* Vector comparison, greater and less than work by magnitude
 	*/